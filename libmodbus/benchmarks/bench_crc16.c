@@ -0,0 +1,107 @@
+/*
+ * libmodbus CRC16 benchmark
+ * Copyright © 2025
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * Checks that every CRC16 implementation is bit-exact with the historical
+ * bytewise tables then measures their throughput on typical frame lengths.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "modbus-private.h"
+
+#define BENCH_BUFFER_LENGTH 256
+#define BENCH_BYTES         (256 * 1024 * 1024)
+
+typedef uint16_t (*crc16_fn)(const uint8_t *buffer, uint16_t buffer_length);
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int check(const char *name, crc16_fn fn, const uint8_t *buffer)
+{
+    int length;
+
+    for (length = 0; length <= BENCH_BUFFER_LENGTH; length++) {
+        uint16_t expected = _modbus_crc16_bytewise(buffer, length);
+        uint16_t crc = fn(buffer, length);
+
+        if (crc != expected) {
+            printf("%s: length %d, CRC 0x%04X != 0x%04X\n", name, length, crc, expected);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void bench(const char *name, crc16_fn fn, const uint8_t *buffer, int length)
+{
+    long iterations = BENCH_BYTES / length;
+    volatile uint16_t sink = 0;
+    double start, elapsed;
+    long i;
+
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        sink ^= fn(buffer, length);
+    }
+    elapsed = now() - start;
+
+    printf("%-10s %4d bytes %9.1f MB/s %8.1f ns/frame\n",
+           name,
+           length,
+           (double) iterations * length / elapsed / 1e6,
+           elapsed * 1e9 / iterations);
+}
+
+int main(void)
+{
+    static const int lengths[] = {8, 16, 64, 128, 256};
+    const struct {
+        const char *name;
+        crc16_fn fn;
+    } impls[] = {
+        {"bytewise", _modbus_crc16_bytewise},
+        {"slice8", _modbus_crc16_slice8},
+        {"clmul", _modbus_crc16_clmul},
+        {"default", _modbus_crc16},
+    };
+    const int nb_impls = sizeof(impls) / sizeof(impls[0]);
+    uint8_t buffer[BENCH_BUFFER_LENGTH];
+    unsigned int i;
+    int j;
+
+    srand(1);
+    for (i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = rand() & 0xFF;
+    }
+
+    printf("Carry-less multiplication: %s\n",
+           _modbus_crc16_has_clmul() ? "available" : "not available");
+
+    for (j = 0; j < nb_impls; j++) {
+        if (check(impls[j].name, impls[j].fn, buffer) == -1) {
+            return EXIT_FAILURE;
+        }
+    }
+    printf("All implementations are bit-exact for lengths 0 to %d\n\n",
+           BENCH_BUFFER_LENGTH);
+
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        for (j = 0; j < nb_impls; j++) {
+            bench(impls[j].name, impls[j].fn, buffer, lengths[i]);
+        }
+        printf("\n");
+    }
+
+    return EXIT_SUCCESS;
+}
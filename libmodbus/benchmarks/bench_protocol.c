@@ -0,0 +1,430 @@
+/*
+ * libmodbus protocol microbenchmarks
+ * Copyright © 2025
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * Measures the hot paths of the protocol stack without any I/O: the CRC16,
+ * modbus_reply() for each function code (response_io_status() for FC01 and
+ * FC02), the client side of each request against a canned response (bit
+ * unpacking of read_io_status() for FC01 and FC02, bit packing of
+ * modbus_write_bits() for FC15, and the packed variants without either) and
+ * the float helpers of modbus-data.c, one value or one array at a time.
+ *
+ * The contexts use a copy of the TCP backend whose send() records the frame,
+ * and whose recv() and select() serve the canned response.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "modbus-private.h"
+#include "modbus-tcp.h"
+
+#define BENCH_SECONDS   0.2
+#define BENCH_BATCH     256
+#define BENCH_BITS      2000
+#define BENCH_REGISTERS 125
+#define BENCH_FLOATS    1024
+
+static modbus_backend_t bench_backend;
+static modbus_mapping_t *mapping;
+
+/* Last frame sent */
+static uint8_t sent[MODBUS_TCP_MAX_ADU_LENGTH];
+static int sent_length;
+
+/* Response served to the client, 0 length to time out */
+static uint8_t canned[MODBUS_TCP_MAX_ADU_LENGTH];
+static int canned_length;
+static int canned_offset;
+
+static uint8_t bits[BENCH_BITS];
+static uint16_t registers[BENCH_REGISTERS];
+static uint16_t float_registers[2 * BENCH_FLOATS];
+static float floats[BENCH_FLOATS];
+static volatile float float_sink;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static ssize_t bench_send(modbus_t *ctx, const uint8_t *req, int req_length)
+{
+    memcpy(sent, req, req_length);
+    sent_length = req_length;
+
+    /* The response follows the transaction ID of the request */
+    canned[0] = req[0];
+    canned[1] = req[1];
+    canned_offset = 0;
+
+    return req_length;
+}
+
+static ssize_t bench_recv(modbus_t *ctx, uint8_t *rsp, int rsp_length)
+{
+    int length = canned_length - canned_offset;
+
+    if (length > rsp_length) {
+        length = rsp_length;
+    }
+    memcpy(rsp, canned + canned_offset, length);
+    canned_offset += length;
+
+    return length;
+}
+
+static int bench_select(modbus_t *ctx, fd_set *rset, struct timeval *tv, int length_to_read)
+{
+    if (canned_offset == canned_length) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    return 1;
+}
+
+static unsigned int bench_is_connected(modbus_t *ctx)
+{
+    return 1;
+}
+
+static modbus_t *bench_new_context(void)
+{
+    modbus_t *ctx = modbus_new_tcp("127.0.0.1", MODBUS_TCP_DEFAULT_PORT);
+
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    bench_backend = *ctx->backend;
+    bench_backend.send = bench_send;
+    bench_backend.recv = bench_recv;
+    bench_backend.select = bench_select;
+    bench_backend.is_connected = bench_is_connected;
+    ctx->backend = &bench_backend;
+    /* Only given to FD_SET(), never closed (no modbus_close()) */
+    ctx->s = 0;
+
+    return ctx;
+}
+
+typedef void (*bench_fn)(void *arg);
+
+static void bench(const char *name, bench_fn fn, void *arg)
+{
+    double start = now();
+    double elapsed;
+    long iterations = 0;
+    int i;
+
+    do {
+        for (i = 0; i < BENCH_BATCH; i++) {
+            fn(arg);
+        }
+        iterations += BENCH_BATCH;
+        elapsed = now() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    printf("%-36s %10.1f ns/op\n", name, elapsed * 1e9 / iterations);
+}
+
+/* CRC16 */
+
+static void run_crc16(void *arg)
+{
+    static uint8_t frame[MODBUS_TCP_MAX_ADU_LENGTH];
+
+    bits[0] ^= (uint8_t) _modbus_crc16(frame, *(int *) arg);
+}
+
+/* Requests of each function code */
+
+typedef struct {
+    const char *name;
+    int (*fn)(modbus_t *ctx);
+    uint8_t req[MODBUS_TCP_MAX_ADU_LENGTH];
+    int req_length;
+    uint8_t rsp[MODBUS_TCP_MAX_ADU_LENGTH];
+    int rsp_length;
+} bench_request_t;
+
+static int read_bits(modbus_t *ctx)
+{
+    return modbus_read_bits(ctx, 0, BENCH_BITS, bits);
+}
+
+static int read_input_bits(modbus_t *ctx)
+{
+    return modbus_read_input_bits(ctx, 0, BENCH_BITS, bits);
+}
+
+static int read_bits_packed(modbus_t *ctx)
+{
+    return modbus_read_bits_packed(ctx, 0, BENCH_BITS, bits);
+}
+
+static int read_registers(modbus_t *ctx)
+{
+    return modbus_read_registers(ctx, 0, BENCH_REGISTERS, registers);
+}
+
+static int read_input_registers(modbus_t *ctx)
+{
+    return modbus_read_input_registers(ctx, 0, BENCH_REGISTERS, registers);
+}
+
+static int write_bit(modbus_t *ctx)
+{
+    return modbus_write_bit(ctx, 0, 1);
+}
+
+static int write_register(modbus_t *ctx)
+{
+    return modbus_write_register(ctx, 0, 0x1234);
+}
+
+static int write_bits(modbus_t *ctx)
+{
+    return modbus_write_bits(ctx, 0, MODBUS_MAX_WRITE_BITS, bits);
+}
+
+static int write_bits_packed(modbus_t *ctx)
+{
+    return modbus_write_bits_packed(ctx, 0, MODBUS_MAX_WRITE_BITS, bits);
+}
+
+static int write_registers(modbus_t *ctx)
+{
+    return modbus_write_registers(ctx, 0, MODBUS_MAX_WRITE_REGISTERS, registers);
+}
+
+static int write_and_read_registers(modbus_t *ctx)
+{
+    return modbus_write_and_read_registers(
+        ctx, 0, MODBUS_MAX_WR_WRITE_REGISTERS, registers, 0, MODBUS_MAX_WR_READ_REGISTERS, registers);
+}
+
+static bench_request_t requests[] = {
+    {"FC01 read_bits 2000", read_bits},
+    {"FC01 read_bits_packed 2000", read_bits_packed},
+    {"FC02 read_input_bits 2000", read_input_bits},
+    {"FC03 read_registers 125", read_registers},
+    {"FC04 read_input_registers 125", read_input_registers},
+    {"FC05 write_bit", write_bit},
+    {"FC06 write_register", write_register},
+    {"FC15 write_bits 1968", write_bits},
+    {"FC15 write_bits_packed 1968", write_bits_packed},
+    {"FC16 write_registers 123", write_registers},
+    {"FC23 write_and_read_registers 121/125", write_and_read_registers},
+};
+
+static modbus_t *client;
+static modbus_t *server;
+
+/* Records the request then the response of the server */
+static int prepare(bench_request_t *request)
+{
+    canned_length = 0;
+    if (request->fn(client) != -1 || errno != ETIMEDOUT) {
+        fprintf(stderr, "%s: request not captured\n", request->name);
+        return -1;
+    }
+    memcpy(request->req, sent, sent_length);
+    request->req_length = sent_length;
+
+    if (modbus_reply(server, request->req, request->req_length, mapping) == -1 ||
+        sent[client->backend->header_length] & 0x80) {
+        fprintf(stderr, "%s: no valid response\n", request->name);
+        return -1;
+    }
+    memcpy(request->rsp, sent, sent_length);
+    request->rsp_length = sent_length;
+
+    return 0;
+}
+
+static void run_reply(void *arg)
+{
+    bench_request_t *request = arg;
+
+    modbus_reply(server, request->req, request->req_length, mapping);
+}
+
+static void run_request(void *arg)
+{
+    bench_request_t *request = arg;
+
+    request->fn(client);
+}
+
+/* Float helpers */
+
+static void run_get_float_abcd(void *arg)
+{
+    int i;
+
+    for (i = 0; i < BENCH_FLOATS; i++) {
+        float_sink = modbus_get_float_abcd(float_registers + 2 * i);
+    }
+}
+
+static void run_get_float_dcba(void *arg)
+{
+    int i;
+
+    for (i = 0; i < BENCH_FLOATS; i++) {
+        float_sink = modbus_get_float_dcba(float_registers + 2 * i);
+    }
+}
+
+static void run_get_float_badc(void *arg)
+{
+    int i;
+
+    for (i = 0; i < BENCH_FLOATS; i++) {
+        float_sink = modbus_get_float_badc(float_registers + 2 * i);
+    }
+}
+
+static void run_get_float_cdab(void *arg)
+{
+    int i;
+
+    for (i = 0; i < BENCH_FLOATS; i++) {
+        float_sink = modbus_get_float_cdab(float_registers + 2 * i);
+    }
+}
+
+static void run_set_float_abcd(void *arg)
+{
+    int i;
+
+    for (i = 0; i < BENCH_FLOATS; i++) {
+        modbus_set_float_abcd(floats[i], float_registers + 2 * i);
+    }
+}
+
+static void run_set_float_dcba(void *arg)
+{
+    int i;
+
+    for (i = 0; i < BENCH_FLOATS; i++) {
+        modbus_set_float_dcba(floats[i], float_registers + 2 * i);
+    }
+}
+
+static void run_set_float_badc(void *arg)
+{
+    int i;
+
+    for (i = 0; i < BENCH_FLOATS; i++) {
+        modbus_set_float_badc(floats[i], float_registers + 2 * i);
+    }
+}
+
+static void run_set_float_cdab(void *arg)
+{
+    int i;
+
+    for (i = 0; i < BENCH_FLOATS; i++) {
+        modbus_set_float_cdab(floats[i], float_registers + 2 * i);
+    }
+}
+
+static void run_get_float_array(void *arg)
+{
+    modbus_get_float_array(float_registers, floats, BENCH_FLOATS, *(modbus_order_t *) arg);
+}
+
+static void run_set_float_array(void *arg)
+{
+    modbus_set_float_array(floats, float_registers, BENCH_FLOATS, *(modbus_order_t *) arg);
+}
+
+int main(void)
+{
+    static const int crc16_lengths[] = {8, 64, 256};
+    const int nb_requests = sizeof(requests) / sizeof(requests[0]);
+    char name[64];
+    unsigned int i;
+    int j;
+
+    mapping = modbus_mapping_new(BENCH_BITS, BENCH_BITS, BENCH_REGISTERS, BENCH_REGISTERS);
+    client = bench_new_context();
+    server = bench_new_context();
+    if (mapping == NULL || client == NULL || server == NULL) {
+        fprintf(stderr, "Initialization failed: %s\n", modbus_strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+    for (j = 0; j < BENCH_BITS; j++) {
+        mapping->tab_bits[j] = rand() & 1;
+        mapping->tab_input_bits[j] = rand() & 1;
+        bits[j] = rand() & 1;
+    }
+    for (j = 0; j < BENCH_FLOATS; j++) {
+        floats[j] = (float) rand() / RAND_MAX * 1000.0f;
+    }
+
+    printf("CRC16\n");
+    for (i = 0; i < sizeof(crc16_lengths) / sizeof(crc16_lengths[0]); i++) {
+        snprintf(name, sizeof(name), "crc16 %d bytes", crc16_lengths[i]);
+        bench(name, run_crc16, (void *) &crc16_lengths[i]);
+    }
+
+    for (j = 0; j < nb_requests; j++) {
+        if (prepare(&requests[j]) == -1) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("\nmodbus_reply()\n");
+    for (j = 0; j < nb_requests; j++) {
+        bench(requests[j].name, run_reply, &requests[j]);
+    }
+
+    printf("\nClient requests (canned responses)\n");
+    for (j = 0; j < nb_requests; j++) {
+        memcpy(canned, requests[j].rsp, requests[j].rsp_length);
+        canned_length = requests[j].rsp_length;
+        if (requests[j].fn(client) == -1) {
+            fprintf(stderr, "%s: %s\n", requests[j].name, modbus_strerror(errno));
+            return EXIT_FAILURE;
+        }
+        bench(requests[j].name, run_request, &requests[j]);
+    }
+
+    printf("\nFloat helpers (%d values per op)\n", BENCH_FLOATS);
+    bench("modbus_set_float_abcd", run_set_float_abcd, NULL);
+    bench("modbus_set_float_dcba", run_set_float_dcba, NULL);
+    bench("modbus_set_float_badc", run_set_float_badc, NULL);
+    bench("modbus_set_float_cdab", run_set_float_cdab, NULL);
+    bench("modbus_get_float_abcd", run_get_float_abcd, NULL);
+    bench("modbus_get_float_dcba", run_get_float_dcba, NULL);
+    bench("modbus_get_float_badc", run_get_float_badc, NULL);
+    bench("modbus_get_float_cdab", run_get_float_cdab, NULL);
+    for (j = 0; j < 4; j++) {
+        static const char *orders[] = {"abcd", "dcba", "badc", "cdab"};
+        modbus_order_t order = (modbus_order_t) j;
+
+        snprintf(name, sizeof(name), "modbus_set_float_array %s", orders[j]);
+        bench(name, run_set_float_array, &order);
+        snprintf(name, sizeof(name), "modbus_get_float_array %s", orders[j]);
+        bench(name, run_get_float_array, &order);
+    }
+
+    modbus_free(client);
+    modbus_free(server);
+    modbus_mapping_free(mapping);
+
+    return EXIT_SUCCESS;
+}
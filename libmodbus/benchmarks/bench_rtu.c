@@ -0,0 +1,317 @@
+/*
+ * libmodbus RTU benchmark on pseudo-terminals
+ * Copyright © 2025
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * Runs an RTU server and an RTU client of the same process on two
+ * pseudo-terminal pairs joined by a relay thread, so that the serial code
+ * paths (timings included) can be exercised without hardware. The relay
+ * delivers each byte after its transmission time at the given baud rate
+ * (start, data, parity and stop bits), a baud rate of 0 disables the pacing.
+ *
+ * Usage: bench_rtu [baud] [requests]
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <pty.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "modbus-rtu.h"
+
+#define BENCH_BAUD      115200
+#define BENCH_PARITY    'N'
+#define BENCH_DATA_BIT  8
+#define BENCH_STOP_BIT  1
+#define BENCH_SLAVE     1
+#define BENCH_REQUESTS  200
+#define BENCH_REGISTERS 125
+
+/* Two pseudo-terminal pairs, the relay copies between the masters */
+typedef struct {
+    int master[2];
+    int slave[2];
+    char name[2][64];
+    /* Transmission time of a character in nanoseconds, 0 without pacing */
+    long char_time;
+    volatile int stop;
+    pthread_t thread;
+} pty_link_t;
+
+static modbus_mapping_t *mapping;
+static volatile int server_stop;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+static void timespec_add(struct timespec *ts, long ns)
+{
+    ts->tv_nsec += ns;
+    while (ts->tv_nsec >= 1000000000L) {
+        ts->tv_nsec -= 1000000000L;
+        ts->tv_sec++;
+    }
+}
+
+static int timespec_before(const struct timespec *a, const struct timespec *b)
+{
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+/* Copies the bytes read on one master to the other one, each byte is written
+   when it would have been fully received on a serial line. Modbus RTU is half
+   duplex so both directions share the same line time. */
+static void *pty_link_relay(void *arg)
+{
+    pty_link_t *link = arg;
+    struct pollfd fds[2];
+    struct timespec line;
+    uint8_t buffer[512];
+    int i;
+
+    fds[0].fd = link->master[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = link->master[1];
+    fds[1].events = POLLIN;
+    clock_gettime(CLOCK_MONOTONIC, &line);
+
+    while (!link->stop) {
+        if (poll(fds, 2, 100) <= 0) {
+            continue;
+        }
+
+        for (i = 0; i < 2; i++) {
+            struct timespec ts;
+            ssize_t rc;
+            ssize_t j;
+
+            if (!(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            rc = read(link->master[i], buffer, sizeof(buffer));
+            if (rc <= 0) {
+                continue;
+            }
+
+            if (link->char_time == 0) {
+                if (write(link->master[1 - i], buffer, rc) != rc) {
+                    perror("relay");
+                }
+                continue;
+            }
+
+            /* The line is idle since the end of the previous character */
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            if (timespec_before(&line, &ts)) {
+                line = ts;
+            }
+            for (j = 0; j < rc; j++) {
+                timespec_add(&line, link->char_time);
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &line, NULL);
+                if (write(link->master[1 - i], buffer + j, 1) != 1) {
+                    perror("relay");
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int pty_link_open(pty_link_t *link, int baud, char parity, int data_bit, int stop_bit)
+{
+    struct termios tios;
+    int i;
+
+    memset(link, 0, sizeof(pty_link_t));
+    cfmakeraw(&tios);
+    for (i = 0; i < 2; i++) {
+        if (openpty(&link->master[i], &link->slave[i], link->name[i], &tios, NULL) == -1) {
+            return -1;
+        }
+    }
+
+    if (baud > 0) {
+        int bits = 1 + data_bit + (parity == 'N' ? 0 : 1) + stop_bit;
+        link->char_time = 1000000000L * bits / baud;
+    }
+
+    if (pthread_create(&link->thread, NULL, pty_link_relay, link) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void pty_link_close(pty_link_t *link)
+{
+    int i;
+
+    link->stop = 1;
+    pthread_join(link->thread, NULL);
+    for (i = 0; i < 2; i++) {
+        close(link->slave[i]);
+        close(link->master[i]);
+    }
+}
+
+static void *rtu_server(void *arg)
+{
+    modbus_t *ctx = arg;
+    uint8_t query[MODBUS_RTU_MAX_ADU_LENGTH];
+
+    while (!server_stop) {
+        int rc = modbus_receive(ctx, query);
+        if (rc > 0) {
+            modbus_reply(ctx, query, rc, mapping);
+        }
+    }
+
+    return NULL;
+}
+
+/* Request and response lengths of a FC03 read or FC16 write of nb registers */
+static int frame_bytes(int function, int nb)
+{
+    /* slave, function, CRC twice, then address and quantity for the request,
+       count byte and data or address and quantity for the response */
+    return function == MODBUS_FC_READ_HOLDING_REGISTERS ? 8 + 5 + 2 * nb : 9 + 2 * nb + 8;
+}
+
+static int bench(modbus_t *ctx, int function, int nb, int nb_requests, int baud)
+{
+    static uint16_t registers[BENCH_REGISTERS];
+    double *latencies = malloc(nb_requests * sizeof(double));
+    double start, elapsed, sum = 0;
+    char name[32];
+    int i;
+
+    if (latencies == NULL) {
+        return -1;
+    }
+
+    start = now();
+    for (i = 0; i < nb_requests; i++) {
+        double t = now();
+        int rc;
+
+        if (function == MODBUS_FC_READ_HOLDING_REGISTERS) {
+            rc = modbus_read_registers(ctx, 0, nb, registers);
+        } else {
+            rc = modbus_write_registers(ctx, 0, nb, registers);
+        }
+        if (rc == -1) {
+            fprintf(stderr, "FC%02d/%d: %s\n", function, nb, modbus_strerror(errno));
+            free(latencies);
+            return -1;
+        }
+        latencies[i] = now() - t;
+        sum += latencies[i];
+    }
+    elapsed = now() - start;
+    qsort(latencies, nb_requests, sizeof(double), compare_double);
+
+    snprintf(name, sizeof(name), "FC%02d %d reg", function, nb);
+    printf("%-14s %5d req %8.1f req/s  mean %8.1f us  p50 %8.1f us  p99 %8.1f us",
+           name,
+           nb_requests,
+           nb_requests / elapsed,
+           sum / nb_requests * 1e6,
+           latencies[nb_requests / 2] * 1e6,
+           latencies[nb_requests * 99 / 100] * 1e6);
+    if (baud > 0) {
+        /* Transmission time of both frames, share of the round trip */
+        int bits = 1 + BENCH_DATA_BIT + (BENCH_PARITY == 'N' ? 0 : 1) + BENCH_STOP_BIT;
+        double wire = frame_bytes(function, nb) * bits * 1e6 / baud;
+        printf("  line %8.1f us (%3.0f%%)", wire, wire * 100 / (sum / nb_requests * 1e6));
+    }
+    printf("\n");
+    free(latencies);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static const int sizes[] = {1, 32, 123};
+    int baud = argc > 1 ? atoi(argv[1]) : BENCH_BAUD;
+    int nb_requests = argc > 2 ? atoi(argv[2]) : BENCH_REQUESTS;
+    pty_link_t link;
+    pthread_t thread;
+    modbus_t *server;
+    modbus_t *client;
+    unsigned int i;
+    int rc = 0;
+
+    if (baud < 0 || nb_requests < 1) {
+        fprintf(stderr, "Usage: %s [baud] [requests]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    mapping = modbus_mapping_new(0, 0, BENCH_REGISTERS, 0);
+    if (mapping == NULL || pty_link_open(&link, baud, BENCH_PARITY, BENCH_DATA_BIT,
+                                         BENCH_STOP_BIT) == -1) {
+        fprintf(stderr, "Initialization failed: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    /* The contexts keep their timings at the paced rate, or the default one */
+    server = modbus_new_rtu(link.name[0], baud > 0 ? baud : BENCH_BAUD, BENCH_PARITY,
+                            BENCH_DATA_BIT, BENCH_STOP_BIT);
+    client = modbus_new_rtu(link.name[1], baud > 0 ? baud : BENCH_BAUD, BENCH_PARITY,
+                            BENCH_DATA_BIT, BENCH_STOP_BIT);
+    if (server == NULL || client == NULL || modbus_connect(server) == -1 ||
+        modbus_connect(client) == -1) {
+        fprintf(stderr, "Connection failed: %s\n", modbus_strerror(errno));
+        return EXIT_FAILURE;
+    }
+    modbus_set_slave(server, BENCH_SLAVE);
+    modbus_set_indication_timeout(server, 0, 100000);
+    modbus_set_slave(client, BENCH_SLAVE);
+    modbus_set_response_timeout(client, 1, 0);
+    pthread_create(&thread, NULL, rtu_server, server);
+
+    if (baud > 0) {
+        printf("RTU over pseudo-terminals, %d bauds %c%d%d\n\n", baud, BENCH_PARITY,
+               BENCH_DATA_BIT, BENCH_STOP_BIT);
+    } else {
+        printf("RTU over pseudo-terminals, no baud rate pacing\n\n");
+    }
+
+    for (i = 0; rc == 0 && i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        rc = bench(client, MODBUS_FC_READ_HOLDING_REGISTERS, sizes[i], nb_requests, baud);
+    }
+    for (i = 0; rc == 0 && i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        rc = bench(client, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, sizes[i], nb_requests, baud);
+    }
+
+    server_stop = 1;
+    pthread_join(thread, NULL);
+    modbus_close(client);
+    modbus_free(client);
+    modbus_close(server);
+    modbus_free(server);
+    pty_link_close(&link);
+    modbus_mapping_free(mapping);
+
+    return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,186 @@
+/*
+ * libmodbus TCP benchmark
+ * Copyright © 2025
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * Starts a server on the loopback interface, one thread per connection, and
+ * drives it with N client threads. Every function code and payload size gives
+ * one CSV line (throughput and latency percentiles) on stdout, so that runs
+ * can be compared by a script to catch regressions.
+ *
+ * Usage: bench_tcp [threads] [requests per thread] [port]
+ */
+
+#include <modbus/modbus.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#define BENCH_ADDRESS       "127.0.0.1"
+#define BENCH_PORT          15021
+#define BENCH_THREADS       4
+#define BENCH_REQUESTS      10000
+#define BENCH_WARMUP        100
+#define BENCH_MAX_BITS      2000
+#define BENCH_MAX_REGISTERS 125
+
+typedef std::chrono::steady_clock Clock;
+
+struct ClientResult {
+    std::vector<double> latencies;  // 微秒
+    Clock::time_point begin;        // 预热之后
+    Clock::time_point end;
+    bool failed = false;
+};
+
+struct BenchCase {
+    int function;
+    int payload;  // 线圈或寄存器数量
+};
+
+static const BenchCase bench_cases[] = {
+    {0x01, 1}, {0x01, 256}, {0x01, 2000},
+    {0x03, 1}, {0x03, 32}, {0x03, 125},
+    {0x06, 1},
+    {0x10, 1}, {0x10, 32}, {0x10, 123},
+    {0x17, 1}, {0x17, 32}, {0x17, 121},
+};
+
+static void request(modbus::Modbus& client, const BenchCase& c, const std::vector<uint16_t>& src) {
+    switch (c.function) {
+    case 0x01:
+        client.read_coils(0, c.payload);
+        break;
+    case 0x03:
+        client.read_holding_registers(0, c.payload);
+        break;
+    case 0x06:
+        client.write_register(0, src[0]);
+        break;
+    case 0x10:
+        client.write_registers(0, src);
+        break;
+    case 0x17:
+        client.write_and_read_registers(0, src, 0, c.payload);
+        break;
+    }
+}
+
+static void client_main(modbus::Modbus* client, const BenchCase* c, int nb_requests,
+                        ClientResult* result) {
+    std::vector<uint16_t> src(c->payload, 0x1234);
+
+    result->latencies.resize(nb_requests);
+    try {
+        for (int i = 0; i < BENCH_WARMUP; i++) {
+            request(*client, *c, src);
+        }
+        result->begin = Clock::now();
+        for (int i = 0; i < nb_requests; i++) {
+            Clock::time_point t = Clock::now();
+            request(*client, *c, src);
+            result->latencies[i] =
+                std::chrono::duration<double, std::micro>(Clock::now() - t).count();
+        }
+        result->end = Clock::now();
+    } catch (const modbus::Exception& e) {
+        std::fprintf(stderr, "FC%02d/%d: %s\n", c->function, c->payload, e.what());
+        result->failed = true;
+    }
+}
+
+// 每个连接一份数据映射，写请求的序列锁只有一个写者
+static void server_main(modbus::ModbusTCPServer* server, modbus::Modbus* connection) {
+    modbus::ModbusTCPServer::Mapping mapping(BENCH_MAX_BITS, 0, BENCH_MAX_REGISTERS, 0);
+
+    while (server->receive_and_reply(*connection, mapping) != -1) {
+    }
+}
+
+static bool run(std::vector<std::unique_ptr<modbus::Modbus> >& clients, const BenchCase& c,
+                int nb_requests) {
+    const int nb_threads = static_cast<int>(clients.size());
+    std::vector<ClientResult> results(nb_threads);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < nb_threads; i++) {
+        threads.push_back(std::thread(client_main, clients[i].get(), &c, nb_requests, &results[i]));
+    }
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    // 吞吐量按所有线程计时区间的并集计算
+    std::vector<double> all;
+    Clock::time_point begin = results[0].begin;
+    Clock::time_point end = results[0].end;
+    for (int i = 0; i < nb_threads; i++) {
+        if (results[i].failed) {
+            return false;
+        }
+        all.insert(all.end(), results[i].latencies.begin(), results[i].latencies.end());
+        begin = std::min(begin, results[i].begin);
+        end = std::max(end, results[i].end);
+    }
+    std::sort(all.begin(), all.end());
+
+    const size_t n = all.size();
+    const double elapsed = std::chrono::duration<double>(end - begin).count();
+    std::printf("%02d,%d,%d,%zu,%.0f,%.2f,%.2f,%.2f\n", c.function, c.payload, nb_threads, n,
+                n / elapsed, all[n / 2], all[n * 99 / 100], all[n * 999 / 1000]);
+    std::fflush(stdout);
+
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int nb_threads = argc > 1 ? std::atoi(argv[1]) : BENCH_THREADS;
+    int nb_requests = argc > 2 ? std::atoi(argv[2]) : BENCH_REQUESTS;
+    int port = argc > 3 ? std::atoi(argv[3]) : BENCH_PORT;
+
+    if (nb_threads < 1 || nb_requests < 1 || port < 1) {
+        std::fprintf(stderr, "Usage: %s [threads] [requests per thread] [port]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    try {
+        modbus::ModbusTCPServer server(BENCH_ADDRESS, port);
+        std::vector<std::unique_ptr<modbus::Modbus> > connections;
+        std::vector<std::unique_ptr<modbus::Modbus> > clients;
+        std::vector<std::thread> servers;
+
+        server.listen(nb_threads);
+        for (int i = 0; i < nb_threads; i++) {
+            std::unique_ptr<modbus::Modbus> client(new modbus::ModbusTCP(BENCH_ADDRESS, port));
+            client->connect();
+            clients.push_back(std::move(client));
+            connections.push_back(server.accept());
+        }
+        // 连接全部建立后才启动服务线程，建立连接时抛出异常不会留下未 join 的线程
+        for (size_t i = 0; i < connections.size(); i++) {
+            servers.push_back(std::thread(server_main, &server, connections[i].get()));
+        }
+
+        std::printf("function,payload,threads,requests,req_per_sec,p50_us,p99_us,p999_us\n");
+        for (size_t i = 0; ok && i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+            ok = run(clients, bench_cases[i], nb_requests);
+        }
+
+        // 客户端断开后服务线程的 receive_and_reply() 返回 -1
+        clients.clear();
+        for (size_t i = 0; i < servers.size(); i++) {
+            servers[i].join();
+        }
+    } catch (const modbus::Exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
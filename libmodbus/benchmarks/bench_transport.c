@@ -0,0 +1,264 @@
+/*
+ * libmodbus transport benchmark
+ * Copyright © 2025
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * Measures the round trip latency of modbus_read_registers() against a
+ * server running in a thread of the same process, over each transport
+ * available on the host (TCP and UDP loopback, the UDP batches and Unix
+ * domain sockets). The in-memory loopback backend gives the cost of the
+ * protocol stack alone, without system calls.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "modbus-tcp.h"
+
+#define BENCH_ADDRESS    "127.0.0.1"
+#define BENCH_PORT       15020
+#define BENCH_UNIX_PATH  "/tmp/bench_transport.sock"
+#define BENCH_REQUESTS   20000
+#define BENCH_REGISTERS  10
+#define BENCH_BATCH_SIZE 16
+
+typedef modbus_t *(*new_server_fn)(void);
+
+static modbus_mapping_t *mapping;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* Answers the requests until the client leaves */
+static void serve(modbus_t *ctx)
+{
+    uint8_t query[MODBUS_TCP_MAX_ADU_LENGTH];
+
+    for (;;) {
+        int rc = modbus_receive(ctx, query);
+        if (rc > 0) {
+            modbus_reply(ctx, query, rc, mapping);
+        } else if (rc == -1) {
+            break;
+        }
+    }
+}
+
+static void *tcp_server(void *arg)
+{
+    modbus_t *ctx = arg;
+    int s = modbus_tcp_listen(ctx, 1);
+
+    if (s == -1 || modbus_tcp_accept(ctx, &s) == -1) {
+        fprintf(stderr, "TCP server: %s\n", modbus_strerror(errno));
+        return NULL;
+    }
+    close(s);
+    serve(ctx);
+
+    return NULL;
+}
+
+static void *unix_server(void *arg)
+{
+    modbus_t *ctx = arg;
+    int s = modbus_unix_listen(ctx, 1);
+
+    if (s == -1 || modbus_unix_accept(ctx, &s) == -1) {
+        fprintf(stderr, "Unix server: %s\n", modbus_strerror(errno));
+        return NULL;
+    }
+    close(s);
+    serve(ctx);
+
+    return NULL;
+}
+
+static void *udp_server(void *arg)
+{
+    serve(arg);
+    return NULL;
+}
+
+/* Latencies are per request, a batch sample covers several requests */
+static void
+report(const char *name, double *latencies, int nb, int nb_requests, double elapsed)
+{
+    double sum = 0;
+    int i;
+
+    qsort(latencies, nb, sizeof(double), compare_double);
+    for (i = 0; i < nb; i++) {
+        sum += latencies[i];
+    }
+
+    printf("%-10s %6d req %9.0f req/s  mean %6.2f us  p50 %6.2f us  p99 %6.2f us  "
+           "p99.9 %6.2f us\n",
+           name,
+           nb_requests,
+           nb_requests / elapsed,
+           sum / nb * 1e6,
+           latencies[nb / 2] * 1e6,
+           latencies[nb * 99 / 100] * 1e6,
+           latencies[nb * 999 / 1000] * 1e6);
+}
+
+static int bench_requests(const char *name, modbus_t *ctx)
+{
+    static double latencies[BENCH_REQUESTS];
+    uint16_t dest[BENCH_REGISTERS];
+    double start;
+    int i;
+
+    for (i = 0; i < BENCH_REQUESTS / 10; i++) {
+        /* Warm up */
+        if (modbus_read_registers(ctx, 0, BENCH_REGISTERS, dest) == -1) {
+            fprintf(stderr, "%s: %s\n", name, modbus_strerror(errno));
+            return -1;
+        }
+    }
+
+    start = now();
+    for (i = 0; i < BENCH_REQUESTS; i++) {
+        double t = now();
+
+        if (modbus_read_registers(ctx, 0, BENCH_REGISTERS, dest) == -1) {
+            fprintf(stderr, "%s: %s\n", name, modbus_strerror(errno));
+            return -1;
+        }
+        latencies[i] = now() - t;
+    }
+    report(name, latencies, BENCH_REQUESTS, BENCH_REQUESTS, now() - start);
+
+    return 0;
+}
+
+static int bench_batches(const char *name, modbus_t *ctx)
+{
+    static double latencies[BENCH_REQUESTS / BENCH_BATCH_SIZE];
+    const int nb_batches = BENCH_REQUESTS / BENCH_BATCH_SIZE;
+    uint16_t dest[BENCH_BATCH_SIZE][BENCH_REGISTERS];
+    modbus_udp_read_t reads[BENCH_BATCH_SIZE];
+    double start;
+    int i;
+
+    for (i = 0; i < BENCH_BATCH_SIZE; i++) {
+        reads[i].slave = MODBUS_TCP_SLAVE;
+        reads[i].addr = i;
+        reads[i].nb = BENCH_REGISTERS;
+        reads[i].dest = dest[i];
+    }
+
+    start = now();
+    for (i = 0; i < nb_batches; i++) {
+        double t = now();
+
+        if (modbus_udp_read_registers_batch(ctx, reads, BENCH_BATCH_SIZE) !=
+            BENCH_BATCH_SIZE) {
+            fprintf(stderr, "%s: batch %d incomplete\n", name, i);
+            return -1;
+        }
+        latencies[i] = (now() - t) / BENCH_BATCH_SIZE;
+    }
+    report(name, latencies, nb_batches, nb_batches * BENCH_BATCH_SIZE, now() - start);
+
+    return 0;
+}
+
+static int run(const char *name,
+               modbus_t *server,
+               void *(*server_main)(void *),
+               modbus_t *client,
+               int batches)
+{
+    pthread_t thread;
+    int rc;
+
+    pthread_create(&thread, NULL, server_main, server);
+    /* Lets the server listen */
+    usleep(100000);
+
+    if (modbus_connect(client) == -1) {
+        fprintf(stderr, "%s: connection failed (%s)\n", name, modbus_strerror(errno));
+        return -1;
+    }
+
+    rc = bench_requests(name, client);
+    if (rc == 0 && batches) {
+        char batch_name[32];
+
+        snprintf(batch_name, sizeof(batch_name), "%s-b%d", name, BENCH_BATCH_SIZE);
+        rc = bench_batches(batch_name, client);
+    }
+
+    modbus_close(client);
+    modbus_free(client);
+    if (batches) {
+        /* The UDP server has no connection to lose */
+        pthread_cancel(thread);
+    }
+    pthread_join(thread, NULL);
+    modbus_close(server);
+    modbus_free(server);
+
+    return rc;
+}
+
+int main(void)
+{
+    modbus_t *server;
+    modbus_t *client;
+    int rc = 0;
+
+    mapping = modbus_mapping_new(0, 0, BENCH_BATCH_SIZE + BENCH_REGISTERS, 0);
+    if (mapping == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    printf("Same host, %d registers per request\n\n", BENCH_REGISTERS);
+
+    server = modbus_new_tcp(BENCH_ADDRESS, BENCH_PORT);
+    rc |= run("tcp", server, tcp_server, modbus_new_tcp(BENCH_ADDRESS, BENCH_PORT), 0);
+
+    server = modbus_new_udp(BENCH_ADDRESS, BENCH_PORT);
+    if (modbus_udp_bind(server) == -1) {
+        fprintf(stderr, "udp: bind failed (%s)\n", modbus_strerror(errno));
+        return EXIT_FAILURE;
+    }
+    rc |= run("udp", server, udp_server, modbus_new_udp(BENCH_ADDRESS, BENCH_PORT), 1);
+
+    server = modbus_new_unix(BENCH_UNIX_PATH);
+    rc |= run("unix", server, unix_server, modbus_new_unix(BENCH_UNIX_PATH), 0);
+    unlink(BENCH_UNIX_PATH);
+
+    /* The request is answered in the client thread */
+    client = modbus_new_loopback(mapping);
+    if (client == NULL || modbus_connect(client) == -1) {
+        fprintf(stderr, "loopback: %s\n", modbus_strerror(errno));
+        return EXIT_FAILURE;
+    }
+    rc |= bench_requests("loopback", client);
+    modbus_free(client);
+
+    modbus_mapping_free(mapping);
+
+    return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
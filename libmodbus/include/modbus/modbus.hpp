@@ -12,9 +12,16 @@
 
 #include <string>
 #include <vector>
+#include <initializer_list>
 #include <stdexcept>
 #include <memory>
 #include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <functional>
+#include <type_traits>
+#include <tuple>
+#include <algorithm>
 
 namespace modbus {
 
@@ -51,12 +58,28 @@ constexpr int RTS_NONE = 0;
 constexpr int RTS_UP = 1;
 constexpr int RTS_DOWN = 2;
 
+// RTU 发送结束等待方式（决定何时释放 RTS）
+constexpr int DRAIN_SLEEP = 0;    // 按波特率估算（默认）
+constexpr int DRAIN_TCDRAIN = 1;  // tcdrain() 等待驱动发送完毕
+constexpr int DRAIN_LSR = 2;      // 另轮询线路状态寄存器直到发送器为空（Linux）
+
+// RTU 帧结束检测方式
+constexpr int RTU_FRAME_LENGTH = 0;   // 根据功能码计算长度（默认）
+constexpr int RTU_FRAME_SILENCE = 1;  // 根据 t3.5 帧间静默
+
+// 总线监听记录类型
+constexpr int RTU_RECORD_REQUEST = 0;
+constexpr int RTU_RECORD_RESPONSE = 1;
+constexpr int RTU_RECORD_INVALID = 2;  // CRC 错误或噪声
+constexpr int RTU_RECORD_IDLE = 3;     // 总线在响应超时内保持空闲（无帧）
+
 // ============================================================================
 // 前向声明 - 隐藏实现细节
 // ============================================================================
 
 class ModbusImpl;
 class MappingImpl;
+class RouterImpl;
 
 /**
  * @brief Modbus 异常类
@@ -72,6 +95,128 @@ private:
     int error_code_;
 };
 
+/**
+ * @brief 打包的位集合，用于线圈和离散输入
+ *
+ * 存储与报文格式一致: 每字节 8 位，低位在前，末字节未用的位为 0。
+ * 读写时直接拷贝，不逐位展开，内存为 std::vector<uint8_t>（每位一字节）的 1/8。
+ */
+class Bits {
+public:
+    // operator[] 返回的代理
+    class Reference {
+    public:
+        Reference(uint8_t* byte, uint8_t mask) : byte_(byte), mask_(mask) {}
+        operator bool() const { return (*byte_ & mask_) != 0; }
+        Reference& operator=(bool value) {
+            if (value) {
+                *byte_ |= mask_;
+            } else {
+                *byte_ &= static_cast<uint8_t>(~mask_);
+            }
+            return *this;
+        }
+        Reference& operator=(const Reference& other) { return *this = static_cast<bool>(other); }
+
+    private:
+        uint8_t* byte_;
+        uint8_t mask_;
+    };
+
+    Bits() : size_(0) {}
+
+    explicit Bits(size_t nb, bool value = false) : size_(0) { resize(nb, value); }
+
+    explicit Bits(const std::vector<bool>& src) : bytes_((src.size() + 7) / 8), size_(src.size()) {
+        for (size_t i = 0; i < size_; i++) {
+            if (src[i]) {
+                bytes_[i / 8] |= static_cast<uint8_t>(1 << (i % 8));
+            }
+        }
+    }
+
+    /**
+     * @brief 从报文格式的字节构造，读取 (nb + 7) / 8 字节
+     */
+    Bits(const uint8_t* packed, size_t nb) : bytes_(packed, packed + (nb + 7) / 8), size_(nb) {
+        clear_padding();
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    /**
+     * @brief 打包后的字节，共 nb_bytes() 个
+     */
+    const uint8_t* data() const { return bytes_.data(); }
+    uint8_t* data() { return bytes_.data(); }
+    size_t nb_bytes() const { return bytes_.size(); }
+
+    bool test(size_t i) const { return (bytes_[i / 8] >> (i % 8)) & 1; }
+    bool operator[](size_t i) const { return test(i); }
+    Reference operator[](size_t i) { return Reference(&bytes_[i / 8], static_cast<uint8_t>(1 << (i % 8))); }
+
+    bool at(size_t i) const {
+        if (i >= size_) {
+            throw Exception("位集合越界", EINVAL);
+        }
+        return test(i);
+    }
+
+    void set(size_t i, bool value = true) { (*this)[i] = value; }
+    void reset(size_t i) { (*this)[i] = false; }
+
+    /**
+     * @brief 置位的数量
+     */
+    size_t count() const {
+        size_t n = 0;
+        for (size_t i = 0; i < bytes_.size(); i++) {
+            for (uint8_t b = bytes_[i]; b; b &= static_cast<uint8_t>(b - 1)) {
+                n++;
+            }
+        }
+        return n;
+    }
+
+    /**
+     * @brief 调整位数，新增的位取 value
+     */
+    void resize(size_t nb, bool value = false) {
+        size_t old_size = size_;
+        bytes_.resize((nb + 7) / 8, value ? 0xFF : 0x00);
+        size_ = nb;
+        if (value) {
+            // 原末字节中未用的位
+            for (size_t i = old_size; i < nb && i % 8 != 0; i++) {
+                set(i);
+            }
+        }
+        clear_padding();
+    }
+
+    std::vector<bool> to_vector() const {
+        std::vector<bool> dest(size_);
+        for (size_t i = 0; i < size_; i++) {
+            dest[i] = test(i);
+        }
+        return dest;
+    }
+
+    bool operator==(const Bits& other) const { return size_ == other.size_ && bytes_ == other.bytes_; }
+    bool operator!=(const Bits& other) const { return !(*this == other); }
+
+private:
+    void clear_padding() {
+        if (size_ % 8) {
+            bytes_.back() &= static_cast<uint8_t>((1 << (size_ % 8)) - 1);
+        }
+    }
+
+    std::vector<uint8_t> bytes_;
+    size_t size_;
+};
+
 /**
  * @brief Modbus 基类 - 使用 RAII 管理资源
  * 采用 pimpl 模式隐藏实现细节
@@ -126,6 +271,17 @@ public:
      */
     std::vector<uint8_t> read_discrete_inputs(int addr, int nb);
 
+    /**
+     * @brief 读取线圈到位集合，dest 调整为 nb 位，重复读取时复用其内存
+     * 按报文格式直接拷贝，免去逐位展开
+     */
+    void read_coils(int addr, int nb, Bits& dest);
+
+    /**
+     * @brief 读取离散输入到位集合
+     */
+    void read_discrete_inputs(int addr, int nb, Bits& dest);
+
     /**
      * @brief 读取保持寄存器 (Holding Registers - Function Code 3)
      */
@@ -151,6 +307,17 @@ public:
      */
     void write_coils(int addr, const std::vector<uint8_t>& src);
 
+    /**
+     * @brief 写多个线圈，数量为 src.size()
+     */
+    void write_coils(int addr, const Bits& src);
+    void write_coils(int addr, const std::vector<bool>& src);
+
+    // 使 write_coils(addr, {1, 0, 1}) 在多个重载间不产生歧义
+    void write_coils(int addr, std::initializer_list<uint8_t> src) {
+        write_coils(addr, std::vector<uint8_t>(src));
+    }
+
     /**
      * @brief 写多个寄存器 (Function Code 16)
      */
@@ -187,6 +354,79 @@ public:
     virtual ~ModbusTCP() = default;
 };
 
+/**
+ * @brief Modbus 本机 Unix 域套接字客户端
+ * 与 TCP 相同的 MBAP 帧，本机进程间通信时省去 TCP 协议栈的开销
+ * 服务端可用 C 接口 modbus_unix_listen() / modbus_unix_accept()
+ */
+class ModbusUnix : public Modbus {
+public:
+    /**
+     * @brief 创建 Unix 域套接字客户端
+     * @param path 套接字路径
+     */
+    explicit ModbusUnix(const std::string& path);
+
+    virtual ~ModbusUnix() = default;
+};
+
+/**
+ * @brief UDP 批量读取的一个读保持寄存器请求
+ */
+struct UdpRead {
+    int slave;
+    int addr;
+    int nb;
+    std::vector<uint16_t> registers;
+    int rc;     // nb 或 -1
+    int error;  // rc 为 -1 时的 errno
+};
+
+/**
+ * @brief Modbus UDP 客户端
+ * 每个数据报一帧 MBAP，无连接状态和队头阻塞，按事务号匹配响应
+ */
+class ModbusUDP : public Modbus {
+public:
+    /**
+     * @brief 创建 UDP 客户端
+     * @param ip IP 地址
+     * @param port 端口号（默认 502）
+     */
+    explicit ModbusUDP(const std::string& ip, int port = DEFAULT_TCP_PORT);
+
+    virtual ~ModbusUDP() = default;
+
+    /**
+     * @brief 设置响应超时后重发请求的次数（默认 0）
+     */
+    void set_retries(int retries);
+
+    /**
+     * @brief 批量读保持寄存器：一次发出全部请求（sendmmsg），按事务号以任意顺序匹配响应
+     * 单项失败不抛异常，结果见各项的 rc / error
+     * @return 成功的项数
+     */
+    int read_registers_batch(std::vector<UdpRead>& reads);
+};
+
+/**
+ * @brief Modbus RTU over TCP 客户端
+ * 串口服务器透传的 RTU 帧（含 CRC、无 MBAP 头），无需额外的协议转换进程
+ * 需用 set_slave() 设置从站地址
+ */
+class ModbusRTUOverTCP : public Modbus {
+public:
+    /**
+     * @brief 创建 RTU over TCP 客户端
+     * @param ip 串口服务器 IP 地址
+     * @param port 端口号
+     */
+    explicit ModbusRTUOverTCP(const std::string& ip, int port);
+
+    virtual ~ModbusRTUOverTCP() = default;
+};
+
 /**
  * @brief Modbus TCP 服务器
  */
@@ -222,8 +462,72 @@ public:
      */
     class Mapping {
     public:
+        /**
+         * @brief POSIX 共享内存段描述
+         *
+         * 段内布局: 头部（魔数、版本、四张表的数量与偏移、序列号），
+         * 随后依次为线圈、离散输入、保持寄存器、输入寄存器四张表。
+         * 其他进程以相同名称和数量构造 Mapping 即可零拷贝访问同一份数据。
+         */
+        struct SharedMemory {
+            /**
+             * @param name 共享内存名称（如 "/modbus-plc"）
+             * @param unlink_on_close 析构时是否删除该共享内存段
+             */
+            explicit SharedMemory(const std::string& name, bool unlink_on_close = false)
+                : name(name), unlink_on_close(unlink_on_close) {}
+
+            std::string name;
+            bool unlink_on_close;
+        };
+
+        /**
+         * @brief 持久化映射文件描述
+         *
+         * 文件内容与共享内存段布局相同（带版本号的头部 + 四张表），
+         * 由 mmap 直接映射，写入落在页缓存中；进程重启后以相同数量
+         * 打开即可恢复上次的数据，无需解析。
+         */
+        struct MappedFile {
+            /**
+             * @param path 文件路径，不存在时创建
+             * @param sync_on_close 析构时是否 msync 刷写到磁盘
+             */
+            explicit MappedFile(const std::string& path, bool sync_on_close = true)
+                : path(path), sync_on_close(sync_on_close) {}
+
+            std::string path;
+            bool sync_on_close;
+        };
+
         explicit Mapping(int nb_bits = 500, int nb_input_bits = 500,
                         int nb_registers = 500, int nb_input_registers = 500);
+
+        /**
+         * @brief 在命名共享内存段上创建或打开映射
+         * 段不存在时创建并清零；已存在时校验头部与给定数量一致
+         */
+        Mapping(const SharedMemory& shm, int nb_bits = 500, int nb_input_bits = 500,
+                int nb_registers = 500, int nb_input_registers = 500);
+
+        /**
+         * @brief 在持久化文件上创建或打开映射
+         * 文件为空时初始化头部；已存在时校验版本与数量一致
+         */
+        Mapping(const MappedFile& file, int nb_bits = 500, int nb_input_bits = 500,
+                int nb_registers = 500, int nb_input_registers = 500);
+
+        /**
+         * @brief 直接包装调用者提供的缓冲区（如已有的 PLC 映像），不做拷贝
+         *
+         * 缓冲区的分配、对齐与生命周期由调用者负责，必须长于本对象；
+         * 数量为 0 的表可传 nullptr。寄存器按主机字节序存放。
+         */
+        Mapping(uint8_t* bits, int nb_bits,
+                uint8_t* input_bits, int nb_input_bits,
+                uint16_t* registers, int nb_registers,
+                uint16_t* input_registers, int nb_input_registers);
+
         ~Mapping();
 
         // 禁止拷贝
@@ -236,21 +540,182 @@ public:
         uint16_t& holding_register(int addr);
         uint16_t& input_register(int addr);
 
+        /**
+         * @brief 序列锁（seqlock）读端: 返回当前序列号，写入进行中时等待
+         *
+         * 用法: do { s = read_begin(); ...读取... } while (read_retry(s));
+         */
+        uint32_t read_begin() const;
+
+        /**
+         * @brief 序列锁读端: 读取期间发生过写入时返回 true，需要重读
+         */
+        bool read_retry(uint32_t sequence) const;
+
+        /**
+         * @brief 序列锁写端: 开始/结束一次写入
+         * receive_and_reply() 处理写请求时会自动调用；
+         * 多个写者之间需自行互斥
+         */
+        void write_begin();
+        void write_end();
+
+        /**
+         * @brief 将文件映射的内容同步刷写到磁盘，其他映射为空操作
+         */
+        void sync();
+
     private:
         friend class ModbusTCPServer;
+        friend class ModbusLoopback;
         std::unique_ptr<MappingImpl> impl_;
     };
 
+    /**
+     * @brief 单元标识符路由 - 一个监听端口服务多个虚拟从站
+     *
+     * 按请求中的单元标识符（0-255）查表（O(1)）分发到对应的数据映射或处理函数。
+     * TCP 下未注册的单元返回网关路径不可用异常（0x0A）；RTU 下忽略，
+     * RTU 广播请求会作用于所有已注册单元。
+     */
+    class Router {
+    public:
+        /**
+         * @brief 自定义处理函数，需自行发送响应（reply() / reply_exception()）
+         * @return 发送的字节数，失败返回 -1
+         */
+        using Handler = std::function<int(Modbus& client, const uint8_t* req, int req_length)>;
+
+        Router();
+        ~Router();
+
+        // 禁止拷贝
+        Router(const Router&) = delete;
+        Router& operator=(const Router&) = delete;
+
+        /**
+         * @brief 将单元标识符映射到数据映射，mapping 的生命周期必须长于路由
+         */
+        void set_mapping(int unit_id, Mapping& mapping);
+
+        /**
+         * @brief 将单元标识符映射到自定义处理函数
+         */
+        void set_handler(int unit_id, Handler handler);
+
+        /**
+         * @brief 移除单元标识符的路由
+         */
+        void remove(int unit_id);
+
+        /**
+         * @brief 从 client 接收一个请求并按单元标识符路由回复
+         * 不需要 ModbusTCPServer 实例，client 可以是 TCP 连接，
+         * 也可以是用 add_slave() 应答多个地址的 ModbusRTU 从站
+         * @return 接收到的字节数，-1 表示连接关闭
+         */
+        int receive_and_reply(Modbus& client);
+
+    private:
+        friend class ModbusTCPServer;
+        std::unique_ptr<RouterImpl> impl_;
+    };
+
     /**
      * @brief 接收并回复请求
      * @return 接收到的字节数，-1 表示连接关闭
      */
     int receive_and_reply(Modbus& client, Mapping& mapping);
 
+    /**
+     * @brief 接收请求并按单元标识符路由回复，同 router.receive_and_reply(client)
+     * @return 接收到的字节数，-1 表示连接关闭
+     */
+    static int receive_and_reply(Modbus& client, Router& router);
+
+    /**
+     * @brief 用数据映射回复一个已接收的请求（供 Router::Handler 使用）
+     */
+    static int reply(Modbus& client, const uint8_t* req, int req_length, Mapping& mapping);
+
+    /**
+     * @brief 回复异常响应（供 Router::Handler 使用）
+     */
+    static int reply_exception(Modbus& client, const uint8_t* req, int exception_code);
+
 private:
     std::unique_ptr<ModbusImpl> impl_;
 };
 
+/**
+ * @brief 进程内回环客户端 - 经内存队列直连一个服务端上下文
+ * 不经过 send/recv/select 系统调用，等待响应时在调用线程内以 mapping 回复请求，
+ * 用于测量和剖析协议栈本身的开销。写请求不更新 Mapping 的序列锁。
+ */
+class ModbusLoopback : public Modbus {
+public:
+    /**
+     * @param mapping 服务端数据映射，生命周期必须长于本对象
+     */
+    explicit ModbusLoopback(ModbusTCPServer::Mapping& mapping);
+
+    virtual ~ModbusLoopback() = default;
+};
+
+/**
+ * @brief RTU 链路统计
+ * 收发转换时间: 帧在线路上发送完毕（按波特率估算）到释放线路之间的时间，单位微秒
+ */
+struct RtuStats {
+    unsigned int nb_turnarounds;  // 已测量的发送次数
+    int turnaround_min;
+    int turnaround_max;
+    int turnaround_mean;
+    int turnaround_jitter;        // 峰峰值抖动 (max - min)
+    uint64_t bus_busy;            // 帧在线路上占用的时间（收发合计）
+    uint64_t bus_elapsed;         // 首帧到末帧经过的时间
+    double bus_utilization;       // 总线利用率 bus_busy / bus_elapsed (0-1)
+};
+
+class ModbusRTU;
+
+/**
+ * @brief 总线监听记录到的一帧
+ */
+struct RtuRecord {
+    int64_t timestamp;          // 帧开始时间（自 Epoch 起的微秒）
+    int duration;               // 帧在线路上的时间（微秒）
+    int type;                   // RTU_RECORD_REQUEST / RESPONSE / INVALID / IDLE
+    int slave;
+    int function;
+    bool crc_ok;
+    int64_t response_time;      // 响应: 请求结束到响应开始的时间（微秒），否则 -1
+    std::vector<uint8_t> data;  // 含 CRC 的完整帧
+};
+
+/**
+ * @brief 多总线轮询的一个读请求（功能码 1-4）
+ * 结果写入 bits（功能码 1、2）或 registers（功能码 3、4）
+ */
+struct RtuScanItem {
+    int slave;
+    int function;
+    int addr;
+    int nb;
+    std::vector<uint8_t> bits;
+    std::vector<uint16_t> registers;
+    int rc;     // nb 或 -1
+    int error;  // rc 为 -1 时的 errno
+};
+
+/**
+ * @brief 一个串口（已连接的 ModbusRTU）的轮询列表
+ */
+struct RtuScanList {
+    ModbusRTU* bus;
+    std::vector<RtuScanItem> items;
+};
+
 /**
  * @brief Modbus RTU 客户端
  */
@@ -278,8 +743,533 @@ public:
      * @brief 设置 RTS 模式
      */
     void set_rts(int mode);
+
+    /**
+     * @brief 发送前严格保证 t3.5 帧间隔（且不多等），按单调时钟计时
+     * 连续发往不同从站的请求会以规范允许的最小间隔紧密排列
+     */
+    void set_frame_gap(bool enable);
+
+    /**
+     * @brief 启用缓冲读取：一次 read() 读出线路上所有可用数据再从缓冲区分帧
+     * 整帧到达时只需一次 select() 和一次 read()（仅用于按长度分帧）
+     */
+    void set_buffered_read(bool enable);
+
+    /**
+     * @brief 设置发送结束等待方式 (DRAIN_SLEEP / DRAIN_TCDRAIN / DRAIN_LSR)
+     * 精确模式下转换时间接近线路发送时间，RTS 延时仅用于发送前
+     */
+    void set_drain_mode(int mode);
+
+    /**
+     * @brief 获取链路统计
+     */
+    RtuStats stats();
+
+    /**
+     * @brief 清零链路统计
+     */
+    void reset_stats();
+
+    /**
+     * @brief 设置帧结束检测方式 (RTU_FRAME_LENGTH / RTU_FRAME_SILENCE)
+     *
+     * 静默检测模式下线路空闲 t3.5 即视为帧结束，遇到噪声或未知功能码时
+     * 只需数毫秒即可重新同步，而不必等待字节超时。
+     */
+    void set_frame_detection(int mode);
+
+    /**
+     * @brief 设置帧间静默时间（微秒），0 表示按波特率计算 t3.5
+     * USB 串口适配器按包上送数据时可适当加大
+     */
+    void set_frame_silence(int us);
+
+    /**
+     * @brief 作为从站时额外应答的从站地址（1-247）
+     *
+     * 除 set_slave() 设置的地址外，发往这些地址的请求同样被接收，
+     * 再由 ModbusTCPServer::Router::receive_and_reply(rtu) 按地址分发，
+     * 即可用一个串口模拟整条 RS-485 总线上的多个从站，无需创建 TCP 服务端。
+     */
+    void add_slave(int slave);
+
+    /**
+     * @brief 移除额外应答的从站地址
+     */
+    void remove_slave(int slave);
+
+    /**
+     * @brief 在单个事件循环中同时轮询多个串口，每个串口按自己的列表和总线时序收发
+     *
+     * 各列表都轮询一遍后返回，吞吐量随串口数量线性增长而无需每个串口一个线程。
+     * 单项失败不抛异常，结果见各项的 rc / error。
+     * @return 成功的项数
+     */
+    static int scan(std::vector<RtuScanList>& lists);
+
+    /**
+     * @brief 只听不发的总线监听：按 t3.5 静默分帧、校验 CRC、记录时间戳并配对请求与响应
+     * 可用于排查和测量第三方主站而不增加总线负载
+     * @param callback 每帧调用一次，总线空闲达响应超时时以 RTU_RECORD_IDLE 调用，
+     *                返回 false 时停止监听
+     */
+    void monitor(const std::function<bool(const RtuRecord&)>& callback);
+};
+
+/**
+ * @brief 多寄存器数值的字节序（A 为最高有效字节）
+ *
+ * 64 位数值: ABCD 为大端 (ABCDEFGH)，DCBA 为小端 (HGFEDCBA)，
+ * BADC 交换每个寄存器内的字节 (BADCFEHG)，CDAB 低位寄存器在前 (GHEFCDAB)。
+ */
+enum class ByteOrder { ABCD = 0, DCBA = 1, BADC = 2, CDAB = 3 };
+
+/**
+ * @brief 批量解码寄存器为数值（32 位类型每个占 2 个寄存器，64 位类型占 4 个）
+ * 支持时使用 SIMD 字节重排，否则逐个转换
+ * @param src 寄存器，至少 nb * 2 或 nb * 4 个
+ * @param dest 输出数值，nb 个
+ */
+void decode_array(const uint16_t* src, float* dest, size_t nb, ByteOrder order);
+void decode_array(const uint16_t* src, double* dest, size_t nb, ByteOrder order);
+void decode_array(const uint16_t* src, int32_t* dest, size_t nb, ByteOrder order);
+void decode_array(const uint16_t* src, uint32_t* dest, size_t nb, ByteOrder order);
+void decode_array(const uint16_t* src, int64_t* dest, size_t nb, ByteOrder order);
+void decode_array(const uint16_t* src, uint64_t* dest, size_t nb, ByteOrder order);
+
+/**
+ * @brief 批量编码数值为寄存器，decode_array() 的逆操作
+ */
+void encode_array(const float* src, uint16_t* dest, size_t nb, ByteOrder order);
+void encode_array(const double* src, uint16_t* dest, size_t nb, ByteOrder order);
+void encode_array(const int32_t* src, uint16_t* dest, size_t nb, ByteOrder order);
+void encode_array(const uint32_t* src, uint16_t* dest, size_t nb, ByteOrder order);
+void encode_array(const int64_t* src, uint16_t* dest, size_t nb, ByteOrder order);
+void encode_array(const uint64_t* src, uint16_t* dest, size_t nb, ByteOrder order);
+
+// ============================================================================
+// 编译期类型化编解码 - 字节序为模板参数，展开为无分支的移位代码
+// ============================================================================
+
+namespace detail {
+
+template <size_t Size> struct UnsignedOfSize;
+template <> struct UnsignedOfSize<2> { typedef uint16_t type; };
+template <> struct UnsignedOfSize<4> { typedef uint32_t type; };
+template <> struct UnsignedOfSize<8> { typedef uint64_t type; };
+
+constexpr uint16_t swap16(uint16_t w) {
+    return static_cast<uint16_t>((w << 8) | (w >> 8));
+}
+
+// DCBA、CDAB 的最低有效寄存器在前；DCBA、BADC 交换寄存器内的字节
+constexpr bool order_reversed(ByteOrder order) {
+    return order == ByteOrder::DCBA || order == ByteOrder::CDAB;
+}
+
+constexpr bool order_swapped(ByteOrder order) {
+    return order == ByteOrder::DCBA || order == ByteOrder::BADC;
+}
+
+// 第 K 个寄存器（从最高有效的开始）在缓冲区中的下标
+constexpr int word_index(ByteOrder order, int words, int k) {
+    return order_reversed(order) ? words - 1 - k : k;
+}
+
+template <typename U, ByteOrder Order, int Words, int K = 0>
+struct WordPacker {
+    static U get(const uint16_t* src) {
+        const uint16_t w = src[word_index(Order, Words, K)];
+        return static_cast<U>(static_cast<U>(order_swapped(Order) ? swap16(w) : w)
+                              << (16 * (Words - 1 - K))) |
+               WordPacker<U, Order, Words, K + 1>::get(src);
+    }
+
+    static void set(U value, uint16_t* dest) {
+        const uint16_t w = static_cast<uint16_t>(value >> (16 * (Words - 1 - K)));
+        dest[word_index(Order, Words, K)] = order_swapped(Order) ? swap16(w) : w;
+        WordPacker<U, Order, Words, K + 1>::set(value, dest);
+    }
+};
+
+template <typename U, ByteOrder Order, int Words>
+struct WordPacker<U, Order, Words, Words> {
+    static U get(const uint16_t*) { return 0; }
+    static void set(U, uint16_t*) {}
+};
+
+template <typename T>
+struct CodecTraits {
+    static_assert(std::is_arithmetic<T>::value &&
+                      (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8),
+                  "16, 32 or 64-bit arithmetic types only");
+    typedef typename UnsignedOfSize<sizeof(T)>::type Unsigned;
+    enum { words = sizeof(T) / 2 };
+};
+
+} // namespace detail
+
+/**
+ * @brief 从寄存器解码一个数值，字节序在编译期确定
+ * 例: decode<float, ByteOrder::CDAB>(regs)；结果与 modbus_get_float_cdab() 一致
+ * @param src 至少 sizeof(T) / 2 个寄存器
+ */
+template <typename T, ByteOrder Order = ByteOrder::ABCD>
+inline T decode(const uint16_t* src) {
+    typedef typename detail::CodecTraits<T>::Unsigned U;
+    const U bits =
+        detail::WordPacker<U, Order, detail::CodecTraits<T>::words>::get(src);
+    T value;
+    std::memcpy(&value, &bits, sizeof(T));
+    return value;
+}
+
+/**
+ * @brief 从寄存器数组的 offset 处解码一个数值，越界时抛出异常
+ */
+template <typename T, ByteOrder Order = ByteOrder::ABCD>
+inline T decode(const std::vector<uint16_t>& registers, size_t offset = 0) {
+    if (offset + detail::CodecTraits<T>::words > registers.size()) {
+        throw Exception("解码失败: 寄存器数量不足", EINVAL);
+    }
+    return decode<T, Order>(registers.data() + offset);
+}
+
+/**
+ * @brief 将一个数值编码到寄存器，字节序在编译期确定
+ * @param dest 至少 sizeof(T) / 2 个寄存器
+ */
+template <typename T, ByteOrder Order = ByteOrder::ABCD>
+inline void encode(T value, uint16_t* dest) {
+    typedef typename detail::CodecTraits<T>::Unsigned U;
+    U bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    detail::WordPacker<U, Order, detail::CodecTraits<T>::words>::set(bits, dest);
+}
+
+/**
+ * @brief 将一个数值编码到寄存器数组的 offset 处，越界时抛出异常
+ */
+template <typename T, ByteOrder Order = ByteOrder::ABCD>
+inline void encode(T value, std::vector<uint16_t>& registers, size_t offset = 0) {
+    if (offset + detail::CodecTraits<T>::words > registers.size()) {
+        throw Exception("编码失败: 寄存器数量不足", EINVAL);
+    }
+    encode<T, Order>(value, registers.data() + offset);
+}
+
+/**
+ * @brief 把寄存器缓冲区视为连续的 T 数组（不拷贝），读写时按 Order 编解码
+ *
+ * 例: RegisterView<float, ByteOrder::CDAB> view(regs);
+ *     float f = view[3]; view[4] = 1.5f;
+ * 缓冲区的生命周期必须长于视图。
+ */
+template <typename T, ByteOrder Order = ByteOrder::ABCD>
+class RegisterView {
+public:
+    enum { words = detail::CodecTraits<T>::words };
+
+    // operator[] 返回的代理，读写都经过编解码
+    class Reference {
+    public:
+        explicit Reference(uint16_t* p) : p_(p) {}
+        operator T() const { return decode<T, Order>(p_); }
+        Reference& operator=(T value) {
+            encode<T, Order>(value, p_);
+            return *this;
+        }
+        Reference& operator=(const Reference& other) { return *this = static_cast<T>(other); }
+
+    private:
+        uint16_t* p_;
+    };
+
+    // 按值返回元素的只读迭代器，可用于范围 for
+    class const_iterator {
+    public:
+        explicit const_iterator(const uint16_t* p) : p_(p) {}
+        T operator*() const { return decode<T, Order>(p_); }
+        const_iterator& operator++() {
+            p_ += words;
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const { return p_ == other.p_; }
+        bool operator!=(const const_iterator& other) const { return p_ != other.p_; }
+
+    private:
+        const uint16_t* p_;
+    };
+
+    /**
+     * @param data 寄存器缓冲区
+     * @param nb_registers 寄存器数量，多余的不足一个值的寄存器被忽略
+     */
+    RegisterView(uint16_t* data, size_t nb_registers)
+        : data_(data), size_(nb_registers / words) {}
+
+    /**
+     * @param registers 寄存器数组，视图从 offset 处开始
+     */
+    explicit RegisterView(std::vector<uint16_t>& registers, size_t offset = 0)
+        : data_(registers.data() + (offset < registers.size() ? offset : registers.size())),
+          size_(offset < registers.size() ? (registers.size() - offset) / words : 0) {}
+
+    size_t size() const { return size_; }
+
+    T get(size_t i) const { return decode<T, Order>(data_ + i * words); }
+    void set(size_t i, T value) { encode<T, Order>(value, data_ + i * words); }
+
+    T operator[](size_t i) const { return get(i); }
+    Reference operator[](size_t i) { return Reference(data_ + i * words); }
+
+    /**
+     * @brief 带边界检查的读取，越界时抛出异常
+     */
+    T at(size_t i) const {
+        if (i >= size_) {
+            throw Exception("寄存器视图越界", EINVAL);
+        }
+        return get(i);
+    }
+
+    const_iterator begin() const { return const_iterator(data_); }
+    const_iterator end() const { return const_iterator(data_ + size_ * words); }
+
+private:
+    uint16_t* data_;
+    size_t size_;
+};
+
+// ============================================================================
+// 声明式寄存器映射 - 结构体字段与寄存器地址一一对应
+// ============================================================================
+
+/**
+ * @brief 寄存器映射中的一个字段: 结构体成员 S::*member 位于寄存器地址 addr
+ * 由 field() 创建，类型与字节序都是模板参数
+ */
+template <typename S, typename T, ByteOrder Order>
+struct RegisterField {
+    typedef S struct_type;
+    typedef T value_type;
+    static constexpr ByteOrder order = Order;
+
+    constexpr RegisterField(int addr, T S::*member) : addr(addr), member(member) {}
+
+    static constexpr int words() { return detail::CodecTraits<T>::words; }
+
+    int addr;
+    T S::*member;
+};
+
+/**
+ * @brief 创建字段描述，例: field<ByteOrder::CDAB>(0, &Meter::voltage)
+ */
+template <ByteOrder Order = ByteOrder::ABCD, typename S, typename T>
+constexpr RegisterField<S, T, Order> field(int addr, T S::*member) {
+    return RegisterField<S, T, Order>(addr, member);
+}
+
+namespace detail {
+
+template <size_t I, size_t N>
+struct FieldLoop {
+    template <typename Tuple, typename F>
+    static void apply(const Tuple& fields, F& f) {
+        f(std::get<I>(fields));
+        FieldLoop<I + 1, N>::apply(fields, f);
+    }
+};
+
+template <size_t N>
+struct FieldLoop<N, N> {
+    template <typename Tuple, typename F>
+    static void apply(const Tuple&, F&) {}
+};
+
+template <typename S>
+struct FieldDecoder {
+    const uint16_t* registers;
+    int base;
+    S* value;
+
+    template <typename Field>
+    void operator()(const Field& f) {
+        value->*(f.member) = decode<typename Field::value_type, Field::order>(registers + f.addr - base);
+    }
+};
+
+template <typename S>
+struct FieldEncoder {
+    uint16_t* registers;
+    int base;
+    const S* value;
+
+    template <typename Field>
+    void operator()(const Field& f) {
+        encode<typename Field::value_type, Field::order>(value->*(f.member), registers + f.addr - base);
+    }
+};
+
+struct FieldRange {
+    int addr;
+    int end;
+
+    bool operator<(const FieldRange& other) const { return addr < other.addr; }
+};
+
+struct FieldCollector {
+    std::vector<FieldRange>* ranges;
+
+    template <typename Field>
+    void operator()(const Field& f) {
+        FieldRange range = {f.addr, f.addr + Field::words()};
+        ranges->push_back(range);
+    }
 };
 
+} // namespace detail
+
+/**
+ * @brief 结构体 S 的寄存器布局，由 make_register_map() 创建
+ *
+ * 构造时按字段地址计算最少的读请求（每个不超过 125 个寄存器），
+ * 读取后在一次遍历中把所有字段解码到结构体，字节序在编译期展开。
+ * 例:
+ *     struct Meter { float voltage; uint16_t status; uint64_t energy; };
+ *     auto map = make_register_map<Meter>(field<ByteOrder::CDAB>(0, &Meter::voltage),
+ *                                         field(2, &Meter::status),
+ *                                         field(10, &Meter::energy));
+ *     Meter m = map.read(client);
+ */
+template <typename S, typename... Fields>
+class RegisterMap {
+public:
+    static_assert(sizeof...(Fields) > 0, "a register map needs at least one field");
+
+    /**
+     * @brief 一次读请求覆盖的寄存器范围
+     */
+    struct Block {
+        int addr;
+        int nb;
+    };
+
+    explicit RegisterMap(const Fields&... fields) : fields_(fields...), max_gap_(-1) {
+        plan();
+    }
+
+    /**
+     * @brief 限制一次请求中顺带读取的未映射寄存器数量
+     * 默认（-1）不限制，请求数最少；0 表示只读取映射的寄存器，
+     * 适用于读取空洞会返回非法地址异常的设备
+     */
+    void set_max_gap(int max_gap) {
+        max_gap_ = max_gap;
+        plan();
+    }
+
+    /**
+     * @brief 读请求列表，按地址排序
+     */
+    const std::vector<Block>& blocks() const { return blocks_; }
+
+    /**
+     * @brief 映射覆盖的首地址和寄存器数量（decode() / encode() 的缓冲区布局）
+     */
+    int base_address() const { return base_; }
+    int nb_registers() const { return nb_registers_; }
+
+    /**
+     * @brief 读取并解码
+     * @param function FC_READ_HOLDING_REGISTERS 或 FC_READ_INPUT_REGISTERS
+     */
+    void read(Modbus& client, S& value, int function = FC_READ_HOLDING_REGISTERS) const {
+        if (function != FC_READ_HOLDING_REGISTERS && function != FC_READ_INPUT_REGISTERS) {
+            throw Exception("读取寄存器映射失败: 功能码无效", EINVAL);
+        }
+        std::vector<uint16_t> registers(nb_registers_);
+        for (size_t i = 0; i < blocks_.size(); i++) {
+            const Block& block = blocks_[i];
+            std::vector<uint16_t> rsp = function == FC_READ_HOLDING_REGISTERS
+                ? client.read_holding_registers(block.addr, block.nb)
+                : client.read_input_registers(block.addr, block.nb);
+            std::copy(rsp.begin(), rsp.end(), registers.begin() + (block.addr - base_));
+        }
+        decode(registers.data(), value);
+    }
+
+    S read(Modbus& client, int function = FC_READ_HOLDING_REGISTERS) const {
+        S value = S();
+        read(client, value, function);
+        return value;
+    }
+
+    /**
+     * @brief 从已读取的寄存器解码，registers[0] 对应 base_address()
+     */
+    void decode(const uint16_t* registers, S& value) const {
+        detail::FieldDecoder<S> decoder = {registers, base_, &value};
+        detail::FieldLoop<0, sizeof...(Fields)>::apply(fields_, decoder);
+    }
+
+    /**
+     * @brief 把结构体编码到寄存器（如服务端数据映射），registers[0] 对应 base_address()
+     */
+    void encode(const S& value, uint16_t* registers) const {
+        detail::FieldEncoder<S> encoder = {registers, base_, &value};
+        detail::FieldLoop<0, sizeof...(Fields)>::apply(fields_, encoder);
+    }
+
+private:
+    // 按地址排序后贪心合并: 间隔不超过 max_gap 且总长度不超过单次读取上限时并入当前请求
+    void plan() {
+        std::vector<detail::FieldRange> ranges;
+        detail::FieldCollector collector = {&ranges};
+        detail::FieldLoop<0, sizeof...(Fields)>::apply(fields_, collector);
+        std::sort(ranges.begin(), ranges.end());
+
+        blocks_.clear();
+        base_ = ranges.front().addr;
+        int end = base_;
+        for (size_t i = 0; i < ranges.size(); i++) {
+            const detail::FieldRange& range = ranges[i];
+            if (!blocks_.empty()) {
+                Block& block = blocks_.back();
+                int block_end = block.addr + block.nb;
+                bool mergeable = max_gap_ < 0 || range.addr - block_end <= max_gap_;
+                int new_end = range.end > block_end ? range.end : block_end;
+                if (mergeable && new_end - block.addr <= MAX_READ_REGISTERS) {
+                    block.nb = new_end - block.addr;
+                    end = new_end > end ? new_end : end;
+                    continue;
+                }
+            }
+            Block block = {range.addr, range.end - range.addr};
+            blocks_.push_back(block);
+            end = range.end > end ? range.end : end;
+        }
+        nb_registers_ = end - base_;
+    }
+
+    std::tuple<Fields...> fields_;
+    int max_gap_;
+    std::vector<Block> blocks_;
+    int base_;
+    int nb_registers_;
+};
+
+/**
+ * @brief 创建结构体 S 的寄存器映射，字段由 field() 描述
+ */
+template <typename S, typename... Fields>
+RegisterMap<S, Fields...> make_register_map(const Fields&... fields) {
+    return RegisterMap<S, Fields...>(fields...);
+}
+
 /**
  * @brief 获取库版本字符串
  */
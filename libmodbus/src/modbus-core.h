@@ -175,6 +175,17 @@ typedef struct _modbus_mapping_t {
     uint16_t *tab_registers;
 } modbus_mapping_t;
 
+/* Unit identifier router: dispatches each request to the mapping or handler
+   registered for its unit identifier (one table slot per possible unit id). */
+typedef struct _modbus_router modbus_router_t;
+
+/* A handler must send its own response (e.g. with modbus_reply() or
+   modbus_reply_exception()) and return the value of that call. */
+typedef int (*modbus_router_handler_t)(modbus_t *ctx,
+                                       const uint8_t *req,
+                                       int req_length,
+                                       void *user_data);
+
 typedef enum {
     MODBUS_ERROR_RECOVERY_NONE = 0,
     MODBUS_ERROR_RECOVERY_LINK = (1 << 1),
@@ -223,6 +234,9 @@ MODBUS_API const char *modbus_strerror(int errnum);
 
 MODBUS_API int modbus_read_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest);
 MODBUS_API int modbus_read_input_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest);
+MODBUS_API int modbus_read_bits_packed(modbus_t *ctx, int addr, int nb, uint8_t *dest);
+MODBUS_API int
+modbus_read_input_bits_packed(modbus_t *ctx, int addr, int nb, uint8_t *dest);
 MODBUS_API int modbus_read_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest);
 MODBUS_API int
 modbus_read_input_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest);
@@ -230,6 +244,8 @@ MODBUS_API int modbus_write_bit(modbus_t *ctx, int coil_addr, int status);
 MODBUS_API int modbus_write_register(modbus_t *ctx, int reg_addr, const uint16_t value);
 MODBUS_API int modbus_write_bits(modbus_t *ctx, int addr, int nb, const uint8_t *data);
 MODBUS_API int
+modbus_write_bits_packed(modbus_t *ctx, int addr, int nb, const uint8_t *data);
+MODBUS_API int
 modbus_write_registers(modbus_t *ctx, int addr, int nb, const uint16_t *data);
 MODBUS_API int
 modbus_mask_write_register(modbus_t *ctx, int addr, uint16_t and_mask, uint16_t or_mask);
@@ -276,6 +292,21 @@ MODBUS_API int modbus_reply(modbus_t *ctx,
                             modbus_mapping_t *mb_mapping);
 MODBUS_API int
 modbus_reply_exception(modbus_t *ctx, const uint8_t *req, unsigned int exception_code);
+
+MODBUS_API modbus_router_t *modbus_router_new(void);
+MODBUS_API void modbus_router_free(modbus_router_t *router);
+MODBUS_API int
+modbus_router_set_mapping(modbus_router_t *router, int unit_id, modbus_mapping_t *mb_mapping);
+MODBUS_API int modbus_router_set_handler(modbus_router_t *router,
+                                         int unit_id,
+                                         modbus_router_handler_t handler,
+                                         void *user_data);
+MODBUS_API int modbus_router_remove(modbus_router_t *router, int unit_id);
+MODBUS_API int modbus_router_reply(modbus_t *ctx,
+                                   const uint8_t *req,
+                                   int req_length,
+                                   modbus_router_t *router);
+
 MODBUS_API int modbus_enable_quirks(modbus_t *ctx, unsigned int quirks_mask);
 MODBUS_API int modbus_disable_quirks(modbus_t *ctx, unsigned int quirks_mask);
 
@@ -318,6 +349,10 @@ MODBUS_API void modbus_set_bits_from_bytes(uint8_t *dest,
 MODBUS_API uint8_t modbus_get_byte_from_bits(const uint8_t *src,
                                              int idx,
                                              unsigned int nb_bits);
+MODBUS_API void modbus_get_bytes_from_bits(const uint8_t *src,
+                                           int idx,
+                                           unsigned int nb_bits,
+                                           uint8_t *tab_byte);
 MODBUS_API float modbus_get_float(const uint16_t *src);
 MODBUS_API float modbus_get_float_abcd(const uint16_t *src);
 MODBUS_API float modbus_get_float_dcba(const uint16_t *src);
@@ -330,6 +365,44 @@ MODBUS_API void modbus_set_float_dcba(float f, uint16_t *dest);
 MODBUS_API void modbus_set_float_badc(float f, uint16_t *dest);
 MODBUS_API void modbus_set_float_cdab(float f, uint16_t *dest);
 
+/* Order of the bytes of a 32-bit value (A is the most significant byte) in two
+   registers. For 64-bit values, ABCD is big endian (ABCDEFGH), DCBA little
+   endian (HGFEDCBA), BADC swaps the bytes of each register (BADCFEHG) and CDAB
+   puts the least significant register first (GHEFCDAB). */
+typedef enum {
+    MODBUS_ORDER_ABCD = 0,
+    MODBUS_ORDER_DCBA,
+    MODBUS_ORDER_BADC,
+    MODBUS_ORDER_CDAB
+} modbus_order_t;
+
+/* Array conversions, nb values of 2 (32-bit) or 4 (64-bit) registers */
+MODBUS_API int
+modbus_get_float_array(const uint16_t *src, float *dest, int nb, modbus_order_t order);
+MODBUS_API int
+modbus_get_double_array(const uint16_t *src, double *dest, int nb, modbus_order_t order);
+MODBUS_API int
+modbus_get_int32_array(const uint16_t *src, int32_t *dest, int nb, modbus_order_t order);
+MODBUS_API int
+modbus_get_uint32_array(const uint16_t *src, uint32_t *dest, int nb, modbus_order_t order);
+MODBUS_API int
+modbus_get_int64_array(const uint16_t *src, int64_t *dest, int nb, modbus_order_t order);
+MODBUS_API int
+modbus_get_uint64_array(const uint16_t *src, uint64_t *dest, int nb, modbus_order_t order);
+
+MODBUS_API int
+modbus_set_float_array(const float *src, uint16_t *dest, int nb, modbus_order_t order);
+MODBUS_API int
+modbus_set_double_array(const double *src, uint16_t *dest, int nb, modbus_order_t order);
+MODBUS_API int
+modbus_set_int32_array(const int32_t *src, uint16_t *dest, int nb, modbus_order_t order);
+MODBUS_API int
+modbus_set_uint32_array(const uint32_t *src, uint16_t *dest, int nb, modbus_order_t order);
+MODBUS_API int
+modbus_set_int64_array(const int64_t *src, uint16_t *dest, int nb, modbus_order_t order);
+MODBUS_API int
+modbus_set_uint64_array(const uint64_t *src, uint16_t *dest, int nb, modbus_order_t order);
+
 #include "modbus-rtu.h"
 #include "modbus-tcp.h"
 
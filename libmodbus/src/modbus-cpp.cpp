@@ -9,9 +9,20 @@
 #include "modbus-tcp.h"
 #include "modbus-rtu.h"
 #include <modbus/modbus-version.h>
+#include <config.h>
+#include <atomic>
+#include <thread>
+#include <climits>
 #include <cstring>
 #include <cerrno>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace modbus {
 
 // 前向声明的实现类
@@ -32,16 +43,223 @@ public:
 class MappingImpl {
 public:
     modbus_mapping_t* mapping = nullptr;
+    // 序列锁计数器，共享内存映射时指向段头部
+    std::atomic<uint32_t>* sequence = &local_sequence;
+    std::atomic<uint32_t> local_sequence{0};
     
     explicit MappingImpl(modbus_mapping_t* m) : mapping(m) {}
+
+    // 将映射内容刷写到持久化存储，仅文件映射需要
+    virtual void sync() {}
     
-    ~MappingImpl() {
+    virtual ~MappingImpl() {
         if (mapping) {
             modbus_mapping_free(mapping);
         }
     }
 };
 
+// 表内存不由 libmodbus 分配的映射，析构时不释放四张表
+class ViewMappingImpl : public MappingImpl {
+public:
+    modbus_mapping_t view;
+
+    ViewMappingImpl() : MappingImpl(nullptr) {
+        std::memset(&view, 0, sizeof(view));
+    }
+
+    ~ViewMappingImpl() override {
+        mapping = nullptr;
+    }
+};
+
+#ifndef _WIN32
+// 共享内存段/映射文件内四张表的布局
+struct SharedMappingLayout {
+    uint32_t version;
+    uint32_t header_size;
+    int32_t nb_bits;
+    int32_t nb_input_bits;
+    int32_t nb_registers;
+    int32_t nb_input_registers;
+    uint32_t offset_bits;
+    uint32_t offset_input_bits;
+    uint32_t offset_registers;
+    uint32_t offset_input_registers;
+    uint32_t total_size;
+};
+
+// 共享内存段头部，位于段起始处
+struct SharedMappingHeader {
+    uint32_t magic;
+    std::atomic<uint32_t> sequence;
+    SharedMappingLayout layout;
+};
+
+constexpr uint32_t SHARED_MAPPING_MAGIC = 0x504D424D; // "MBMP"
+constexpr uint32_t SHARED_MAPPING_VERSION = 1;
+// 每张表按缓存行对齐，避免不同表的写入互相干扰
+constexpr uint32_t SHARED_MAPPING_ALIGN = 64;
+
+static uint32_t align_up(uint32_t value) {
+    return (value + SHARED_MAPPING_ALIGN - 1) & ~(SHARED_MAPPING_ALIGN - 1);
+}
+
+// 根据四张表的数量计算段内布局
+static SharedMappingLayout shared_mapping_layout(int nb_bits, int nb_input_bits,
+                                                 int nb_registers, int nb_input_registers) {
+    SharedMappingLayout layout;
+    layout.version = SHARED_MAPPING_VERSION;
+    layout.header_size = sizeof(SharedMappingHeader);
+    layout.nb_bits = nb_bits;
+    layout.nb_input_bits = nb_input_bits;
+    layout.nb_registers = nb_registers;
+    layout.nb_input_registers = nb_input_registers;
+    layout.offset_bits = align_up(sizeof(SharedMappingHeader));
+    layout.offset_input_bits = align_up(layout.offset_bits + nb_bits);
+    layout.offset_registers = align_up(layout.offset_input_bits + nb_input_bits);
+    layout.offset_input_registers =
+        align_up(layout.offset_registers + nb_registers * sizeof(uint16_t));
+    layout.total_size = layout.offset_input_registers + nb_input_registers * sizeof(uint16_t);
+    return layout;
+}
+
+// 映射到 fd 所指向对象上的 Mapping，创建时初始化头部，打开时校验头部
+class SegmentMappingImpl : public ViewMappingImpl {
+public:
+    void* base = MAP_FAILED;
+    size_t size = 0;
+
+    /* recover 为 true 时，将上次进程在写入中途退出而遗留的奇数序列号复位 */
+    void attach(int fd, int nb_bits, int nb_input_bits, int nb_registers,
+                int nb_input_registers, bool recover = false) {
+        if (nb_bits < 0 || nb_input_bits < 0 || nb_registers < 0 || nb_input_registers < 0) {
+            throw Exception("创建数据映射失败: 数量不能为负", EINVAL);
+        }
+
+        SharedMappingLayout layout =
+            shared_mapping_layout(nb_bits, nb_input_bits, nb_registers, nb_input_registers);
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            throw Exception("获取共享内存段信息失败: " + std::string(strerror(errno)));
+        }
+
+        bool created = (st.st_size == 0);
+        if (created) {
+            if (ftruncate(fd, layout.total_size) == -1) {
+                throw Exception("设置共享内存段大小失败: " + std::string(strerror(errno)));
+            }
+        } else if (static_cast<uint64_t>(st.st_size) != layout.total_size) {
+            throw Exception("共享内存段大小与映射布局不匹配", EINVAL);
+        }
+
+        size = layout.total_size;
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            throw Exception("映射共享内存段失败: " + std::string(strerror(errno)));
+        }
+
+        SharedMappingHeader* header = static_cast<SharedMappingHeader*>(base);
+        if (created || header->magic == 0) {
+            // 新段由 ftruncate 清零，只需写入头部；魔数最后写入
+            header->layout = layout;
+            std::atomic_thread_fence(std::memory_order_release);
+            header->magic = SHARED_MAPPING_MAGIC;
+        } else if (header->magic != SHARED_MAPPING_MAGIC ||
+                   std::memcmp(&header->layout, &layout, sizeof(layout)) != 0) {
+            throw Exception("共享内存段头部与映射布局不匹配", EINVAL);
+        } else if (recover && (header->sequence.load(std::memory_order_relaxed) & 1)) {
+            header->sequence.fetch_add(1, std::memory_order_release);
+        }
+
+        uint8_t* bytes = static_cast<uint8_t*>(base);
+        view.nb_bits = nb_bits;
+        view.nb_input_bits = nb_input_bits;
+        view.nb_registers = nb_registers;
+        view.nb_input_registers = nb_input_registers;
+        view.tab_bits = nb_bits ? bytes + layout.offset_bits : nullptr;
+        view.tab_input_bits = nb_input_bits ? bytes + layout.offset_input_bits : nullptr;
+        view.tab_registers = nb_registers
+            ? reinterpret_cast<uint16_t*>(bytes + layout.offset_registers) : nullptr;
+        view.tab_input_registers = nb_input_registers
+            ? reinterpret_cast<uint16_t*>(bytes + layout.offset_input_registers) : nullptr;
+        sequence = &header->sequence;
+        mapping = &view;
+    }
+
+    ~SegmentMappingImpl() override {
+        if (base != MAP_FAILED) {
+            munmap(base, size);
+        }
+    }
+};
+
+class FileMappingImpl : public SegmentMappingImpl {
+public:
+    bool sync_on_close = true;
+
+    void sync() override {
+        if (msync(base, size, MS_SYNC) == -1) {
+            throw Exception("刷写映射文件失败: " + std::string(strerror(errno)));
+        }
+    }
+
+    ~FileMappingImpl() override {
+        if (sync_on_close && base != MAP_FAILED) {
+            msync(base, size, MS_SYNC);
+        }
+    }
+};
+#endif
+
+#ifdef HAVE_SHM_OPEN
+class SharedMappingImpl : public SegmentMappingImpl {
+public:
+    std::string name;
+    bool unlink_on_close = false;
+
+    ~SharedMappingImpl() override {
+        if (unlink_on_close) {
+            shm_unlink(name.c_str());
+        }
+    }
+};
+#endif
+
+// 路由表的每个单元对应一个槽位，作为 C 回调的 user_data
+struct RouterSlot {
+    RouterImpl* owner = nullptr;
+    ModbusTCPServer::Mapping* mapping = nullptr;
+    ModbusTCPServer::Router::Handler handler;
+};
+
+class RouterImpl {
+public:
+    modbus_router_t* router = nullptr;
+    // 当前正在处理请求的客户端，仅在 receive_and_reply 期间有效
+    Modbus* client = nullptr;
+    RouterSlot slots[256];
+
+    RouterImpl() : router(modbus_router_new()) {
+        for (RouterSlot& slot : slots) {
+            slot.owner = this;
+        }
+    }
+
+    ~RouterImpl() {
+        modbus_router_free(router);
+    }
+
+    static int dispatch(modbus_t*, const uint8_t* req, int req_length, void* user_data) {
+        RouterSlot* slot = static_cast<RouterSlot*>(user_data);
+        Modbus& client = *slot->owner->client;
+        if (slot->mapping) {
+            return ModbusTCPServer::reply(client, req, req_length, *slot->mapping);
+        }
+        return slot->handler(client, req, req_length);
+    }
+};
+
 // Exception 实现
 Exception::Exception(const std::string& message)
     : std::runtime_error(message), error_code_(errno) {}
@@ -113,6 +331,20 @@ std::vector<uint8_t> Modbus::read_discrete_inputs(int addr, int nb) {
     return dest;
 }
 
+void Modbus::read_coils(int addr, int nb, Bits& dest) {
+    dest.resize(nb > 0 ? nb : 0);
+    if (modbus_read_bits_packed(impl_->ctx, addr, nb, dest.data()) == -1) {
+        throw Exception("读取线圈失败: " + std::string(modbus_strerror(errno)));
+    }
+}
+
+void Modbus::read_discrete_inputs(int addr, int nb, Bits& dest) {
+    dest.resize(nb > 0 ? nb : 0);
+    if (modbus_read_input_bits_packed(impl_->ctx, addr, nb, dest.data()) == -1) {
+        throw Exception("读取离散输入失败: " + std::string(modbus_strerror(errno)));
+    }
+}
+
 std::vector<uint16_t> Modbus::read_holding_registers(int addr, int nb) {
     std::vector<uint16_t> dest(nb);
     int rc = modbus_read_registers(impl_->ctx, addr, nb, dest.data());
@@ -151,6 +383,16 @@ void Modbus::write_coils(int addr, const std::vector<uint8_t>& src) {
     }
 }
 
+void Modbus::write_coils(int addr, const Bits& src) {
+    if (modbus_write_bits_packed(impl_->ctx, addr, src.size(), src.data()) == -1) {
+        throw Exception("写入多个线圈失败: " + std::string(modbus_strerror(errno)));
+    }
+}
+
+void Modbus::write_coils(int addr, const std::vector<bool>& src) {
+    write_coils(addr, Bits(src));
+}
+
 void Modbus::write_registers(int addr, const std::vector<uint16_t>& src) {
     if (modbus_write_registers(impl_->ctx, addr, src.size(), src.data()) == -1) {
         throw Exception("写入多个寄存器失败: " + std::string(modbus_strerror(errno)));
@@ -177,6 +419,49 @@ std::vector<uint16_t> Modbus::write_and_read_registers(
 ModbusTCP::ModbusTCP(const std::string& ip, int port)
     : Modbus(std::make_unique<ModbusImpl>(modbus_new_tcp(ip.c_str(), port))) {}
 
+// ModbusUnix 实现
+ModbusUnix::ModbusUnix(const std::string& path)
+    : Modbus(std::make_unique<ModbusImpl>(modbus_new_unix(path.c_str()))) {}
+
+// ModbusUDP 实现
+ModbusUDP::ModbusUDP(const std::string& ip, int port)
+    : Modbus(std::make_unique<ModbusImpl>(modbus_new_udp(ip.c_str(), port))) {}
+
+void ModbusUDP::set_retries(int retries) {
+    if (modbus_udp_set_retries(impl_->ctx, retries) == -1) {
+        throw Exception("设置重发次数失败");
+    }
+}
+
+int ModbusUDP::read_registers_batch(std::vector<UdpRead>& reads) {
+    std::vector<modbus_udp_read_t> c_reads(reads.size());
+
+    for (size_t i = 0; i < reads.size(); i++) {
+        reads[i].registers.resize(reads[i].nb > 0 ? reads[i].nb : 0);
+        c_reads[i].slave = reads[i].slave;
+        c_reads[i].addr = reads[i].addr;
+        c_reads[i].nb = reads[i].nb;
+        c_reads[i].dest = reads[i].registers.data();
+    }
+
+    int rc = modbus_udp_read_registers_batch(impl_->ctx, c_reads.data(),
+                                             static_cast<int>(c_reads.size()));
+    if (rc == -1) {
+        throw Exception("批量读取失败: " + std::string(modbus_strerror(errno)));
+    }
+
+    for (size_t i = 0; i < reads.size(); i++) {
+        reads[i].rc = c_reads[i].rc;
+        reads[i].error = c_reads[i].error;
+    }
+
+    return rc;
+}
+
+// ModbusRTUOverTCP 实现
+ModbusRTUOverTCP::ModbusRTUOverTCP(const std::string& ip, int port)
+    : Modbus(std::make_unique<ModbusImpl>(modbus_new_rtu_tcp(ip.c_str(), port))) {}
+
 // ModbusRTU 实现
 ModbusRTU::ModbusRTU(const std::string& device, int baud,
                      char parity, int data_bit, int stop_bit)
@@ -195,6 +480,143 @@ void ModbusRTU::set_rts(int mode) {
     }
 }
 
+void ModbusRTU::set_frame_gap(bool enable) {
+    if (modbus_rtu_set_frame_gap(impl_->ctx, enable ? 1 : 0) == -1) {
+        throw Exception("设置帧间隔调度失败");
+    }
+}
+
+void ModbusRTU::set_buffered_read(bool enable) {
+    if (modbus_rtu_set_buffered_read(impl_->ctx, enable ? 1 : 0) == -1) {
+        throw Exception("设置缓冲读取失败");
+    }
+}
+
+void ModbusRTU::set_drain_mode(int mode) {
+    if (modbus_rtu_set_drain_mode(impl_->ctx, mode) == -1) {
+        throw Exception("设置发送结束等待方式失败");
+    }
+}
+
+RtuStats ModbusRTU::stats() {
+    modbus_rtu_stats_t st;
+    if (modbus_rtu_get_stats(impl_->ctx, &st) == -1) {
+        throw Exception("获取链路统计失败");
+    }
+
+    RtuStats result;
+    result.nb_turnarounds = st.nb_turnarounds;
+    result.turnaround_min = st.turnaround_min;
+    result.turnaround_max = st.turnaround_max;
+    result.turnaround_mean = st.turnaround_mean;
+    result.turnaround_jitter = st.turnaround_jitter;
+    result.bus_busy = st.bus_busy;
+    result.bus_elapsed = st.bus_elapsed;
+    result.bus_utilization = st.bus_utilization;
+    return result;
+}
+
+void ModbusRTU::reset_stats() {
+    if (modbus_rtu_reset_stats(impl_->ctx) == -1) {
+        throw Exception("清零链路统计失败");
+    }
+}
+
+int ModbusRTU::scan(std::vector<RtuScanList>& lists) {
+    std::vector<modbus_rtu_scan_list_t> c_lists(lists.size());
+    std::vector<std::vector<modbus_rtu_scan_item_t> > c_items(lists.size());
+
+    for (size_t i = 0; i < lists.size(); i++) {
+        if (lists[i].bus == nullptr) {
+            throw Exception("多总线轮询失败: " + std::string(modbus_strerror(EINVAL)));
+        }
+
+        c_items[i].resize(lists[i].items.size());
+        for (size_t j = 0; j < lists[i].items.size(); j++) {
+            RtuScanItem& item = lists[i].items[j];
+            modbus_rtu_scan_item_t& c_item = c_items[i][j];
+
+            if (item.function == MODBUS_FC_READ_COILS ||
+                item.function == MODBUS_FC_READ_DISCRETE_INPUTS) {
+                item.bits.resize(item.nb > 0 ? item.nb : 0);
+                c_item.dest = item.bits.data();
+            } else {
+                item.registers.resize(item.nb > 0 ? item.nb : 0);
+                c_item.dest = item.registers.data();
+            }
+            c_item.slave = item.slave;
+            c_item.function = item.function;
+            c_item.addr = item.addr;
+            c_item.nb = item.nb;
+        }
+
+        c_lists[i].ctx = lists[i].bus->impl_->ctx;
+        c_lists[i].items = c_items[i].data();
+        c_lists[i].nb_items = static_cast<int>(c_items[i].size());
+    }
+
+    int rc = modbus_rtu_scan(c_lists.data(), static_cast<int>(c_lists.size()));
+    if (rc == -1) {
+        throw Exception("多总线轮询失败: " + std::string(modbus_strerror(errno)));
+    }
+
+    for (size_t i = 0; i < lists.size(); i++) {
+        for (size_t j = 0; j < lists[i].items.size(); j++) {
+            lists[i].items[j].rc = c_items[i][j].rc;
+            lists[i].items[j].error = c_items[i][j].error;
+        }
+    }
+
+    return rc;
+}
+
+static int monitor_trampoline(modbus_t*, const modbus_rtu_record_t* c_record, void* user_data) {
+    const auto& callback = *static_cast<const std::function<bool(const RtuRecord&)>*>(user_data);
+
+    RtuRecord record;
+    record.timestamp = c_record->timestamp;
+    record.duration = c_record->duration;
+    record.type = c_record->type;
+    record.slave = c_record->slave;
+    record.function = c_record->function;
+    record.crc_ok = c_record->crc_ok != 0;
+    record.response_time = c_record->response_time;
+    record.data.assign(c_record->data, c_record->data + c_record->length);
+
+    return callback(record) ? 0 : 1;
+}
+
+void ModbusRTU::monitor(const std::function<bool(const RtuRecord&)>& callback) {
+    std::function<bool(const RtuRecord&)> cb = callback;
+    if (modbus_rtu_monitor(impl_->ctx, monitor_trampoline, &cb) == -1) {
+        throw Exception("总线监听失败: " + std::string(modbus_strerror(errno)));
+    }
+}
+
+void ModbusRTU::set_frame_detection(int mode) {
+    if (modbus_rtu_set_frame_detection(impl_->ctx, mode) == -1) {
+        throw Exception("设置帧检测方式失败");
+    }
+}
+
+void ModbusRTU::set_frame_silence(int us) {
+    if (modbus_rtu_set_frame_silence(impl_->ctx, us) == -1) {
+        throw Exception("设置帧间静默时间失败");
+    }
+}
+
+void ModbusRTU::add_slave(int slave) {
+    if (modbus_rtu_add_slave(impl_->ctx, slave) == -1) {
+        throw Exception("添加从站地址失败: " + std::string(modbus_strerror(errno)));
+    }
+}
+
+void ModbusRTU::remove_slave(int slave) {
+    if (modbus_rtu_remove_slave(impl_->ctx, slave) == -1) {
+        throw Exception("移除从站地址失败: " + std::string(modbus_strerror(errno)));
+    }
+}
+
 // ModbusTCPServer 实现
 class ServerImpl : public ModbusImpl {
 public:
@@ -259,8 +681,115 @@ ModbusTCPServer::Mapping::Mapping(int nb_bits, int nb_input_bits,
     }
 }
 
+ModbusTCPServer::Mapping::Mapping(const SharedMemory& shm, int nb_bits, int nb_input_bits,
+                                  int nb_registers, int nb_input_registers) {
+#ifdef HAVE_SHM_OPEN
+    std::unique_ptr<SharedMappingImpl> impl(new SharedMappingImpl());
+    int fd = shm_open(shm.name.c_str(), O_RDWR | O_CREAT, 0660);
+    if (fd == -1) {
+        throw Exception("打开共享内存段失败: " + std::string(strerror(errno)));
+    }
+    impl->name = shm.name;
+    try {
+        impl->attach(fd, nb_bits, nb_input_bits, nb_registers, nb_input_registers);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    /* 映射建立后文件描述符不再需要 */
+    ::close(fd);
+    impl->unlink_on_close = shm.unlink_on_close;
+    impl_ = std::move(impl);
+#else
+    (void) shm;
+    (void) nb_bits;
+    (void) nb_input_bits;
+    (void) nb_registers;
+    (void) nb_input_registers;
+    throw Exception("当前平台不支持共享内存映射", ENOTSUP);
+#endif
+}
+
+ModbusTCPServer::Mapping::Mapping(const MappedFile& file, int nb_bits, int nb_input_bits,
+                                  int nb_registers, int nb_input_registers) {
+#ifndef _WIN32
+    std::unique_ptr<FileMappingImpl> impl(new FileMappingImpl());
+    int fd = ::open(file.path.c_str(), O_RDWR | O_CREAT, 0660);
+    if (fd == -1) {
+        throw Exception("打开映射文件失败: " + std::string(strerror(errno)));
+    }
+    try {
+        impl->attach(fd, nb_bits, nb_input_bits, nb_registers, nb_input_registers, true);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    impl->sync_on_close = file.sync_on_close;
+    impl_ = std::move(impl);
+#else
+    (void) file;
+    (void) nb_bits;
+    (void) nb_input_bits;
+    (void) nb_registers;
+    (void) nb_input_registers;
+    throw Exception("当前平台不支持文件映射", ENOTSUP);
+#endif
+}
+
+ModbusTCPServer::Mapping::Mapping(uint8_t* bits, int nb_bits,
+                                  uint8_t* input_bits, int nb_input_bits,
+                                  uint16_t* registers, int nb_registers,
+                                  uint16_t* input_registers, int nb_input_registers) {
+    if (nb_bits < 0 || nb_input_bits < 0 || nb_registers < 0 || nb_input_registers < 0 ||
+        (nb_bits > 0 && bits == nullptr) ||
+        (nb_input_bits > 0 && input_bits == nullptr) ||
+        (nb_registers > 0 && registers == nullptr) ||
+        (nb_input_registers > 0 && input_registers == nullptr)) {
+        throw Exception("创建数据映射失败: 缓冲区与数量不匹配", EINVAL);
+    }
+
+    std::unique_ptr<ViewMappingImpl> impl(new ViewMappingImpl());
+    impl->view.nb_bits = nb_bits;
+    impl->view.tab_bits = nb_bits ? bits : nullptr;
+    impl->view.nb_input_bits = nb_input_bits;
+    impl->view.tab_input_bits = nb_input_bits ? input_bits : nullptr;
+    impl->view.nb_registers = nb_registers;
+    impl->view.tab_registers = nb_registers ? registers : nullptr;
+    impl->view.nb_input_registers = nb_input_registers;
+    impl->view.tab_input_registers = nb_input_registers ? input_registers : nullptr;
+    impl->mapping = &impl->view;
+    impl_ = std::move(impl);
+}
+
 ModbusTCPServer::Mapping::~Mapping() = default;
 
+uint32_t ModbusTCPServer::Mapping::read_begin() const {
+    uint32_t sequence;
+    while ((sequence = impl_->sequence->load(std::memory_order_acquire)) & 1) {
+        std::this_thread::yield();
+    }
+    return sequence;
+}
+
+bool ModbusTCPServer::Mapping::read_retry(uint32_t sequence) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return impl_->sequence->load(std::memory_order_relaxed) != sequence;
+}
+
+void ModbusTCPServer::Mapping::write_begin() {
+    impl_->sequence->fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void ModbusTCPServer::Mapping::write_end() {
+    impl_->sequence->fetch_add(1, std::memory_order_release);
+}
+
+void ModbusTCPServer::Mapping::sync() {
+    impl_->sync();
+}
+
 uint8_t& ModbusTCPServer::Mapping::coil(int addr) {
     return impl_->mapping->tab_bits[addr];
 }
@@ -277,18 +806,182 @@ uint16_t& ModbusTCPServer::Mapping::input_register(int addr) {
     return impl_->mapping->tab_input_registers[addr];
 }
 
+// 会修改映射内容的功能码
+static bool is_write_function(int function) {
+    switch (function) {
+    case MODBUS_FC_WRITE_SINGLE_COIL:
+    case MODBUS_FC_WRITE_SINGLE_REGISTER:
+    case MODBUS_FC_WRITE_MULTIPLE_COILS:
+    case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+    case MODBUS_FC_MASK_WRITE_REGISTER:
+    case MODBUS_FC_WRITE_AND_READ_REGISTERS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+int ModbusTCPServer::reply(Modbus& client, const uint8_t* req, int req_length,
+                           Mapping& mapping) {
+    int function = req[modbus_get_header_length(client.impl_->ctx)];
+    if (!is_write_function(function)) {
+        return modbus_reply(client.impl_->ctx, req, req_length, mapping.impl_->mapping);
+    }
+
+    // 让其他进程的读者能检测到这次写入
+    mapping.write_begin();
+    int rc = modbus_reply(client.impl_->ctx, req, req_length, mapping.impl_->mapping);
+    mapping.write_end();
+    return rc;
+}
+
+int ModbusTCPServer::reply_exception(Modbus& client, const uint8_t* req, int exception_code) {
+    return modbus_reply_exception(client.impl_->ctx, req, exception_code);
+}
+
 int ModbusTCPServer::receive_and_reply(Modbus& client, Mapping& mapping) {
     uint8_t query[MODBUS_TCP_MAX_ADU_LENGTH];
     int rc = modbus_receive(client.impl_->ctx, query);
     
     if (rc > 0) {
-        modbus_reply(client.impl_->ctx, query, rc, mapping.impl_->mapping);
+        reply(client, query, rc, mapping);
     } else if (rc == -1) {
         return -1; // 连接关闭
     }
     return rc;
 }
 
+int ModbusTCPServer::receive_and_reply(Modbus& client, Router& router) {
+    return router.receive_and_reply(client);
+}
+
+// Router 实现
+ModbusTCPServer::Router::Router() : impl_(std::make_unique<RouterImpl>()) {
+    if (!impl_->router) {
+        throw Exception("创建路由失败: " + std::string(modbus_strerror(errno)));
+    }
+}
+
+ModbusTCPServer::Router::~Router() = default;
+
+int ModbusTCPServer::Router::receive_and_reply(Modbus& client) {
+    uint8_t query[MODBUS_TCP_MAX_ADU_LENGTH];
+    int rc = modbus_receive(client.impl_->ctx, query);
+
+    if (rc > 0) {
+        impl_->client = &client;
+        modbus_router_reply(client.impl_->ctx, query, rc, impl_->router);
+        impl_->client = nullptr;
+    } else if (rc == -1) {
+        return -1; // 连接关闭
+    }
+    return rc;
+}
+
+void ModbusTCPServer::Router::set_mapping(int unit_id, Mapping& mapping) {
+    if (unit_id < 0 || unit_id > 255) {
+        throw Exception("设置路由失败: 单元标识符超出范围", EINVAL);
+    }
+    RouterSlot& slot = impl_->slots[unit_id];
+    // 经由处理函数转发，以便写请求同样更新序列锁
+    if (modbus_router_set_handler(impl_->router, unit_id, &RouterImpl::dispatch, &slot) == -1) {
+        throw Exception("设置路由失败: " + std::string(modbus_strerror(errno)));
+    }
+    slot.mapping = &mapping;
+    slot.handler = nullptr;
+}
+
+void ModbusTCPServer::Router::set_handler(int unit_id, Handler handler) {
+    if (unit_id < 0 || unit_id > 255 || !handler) {
+        throw Exception("设置路由失败: 参数无效", EINVAL);
+    }
+    RouterSlot& slot = impl_->slots[unit_id];
+    if (modbus_router_set_handler(impl_->router, unit_id, &RouterImpl::dispatch, &slot) == -1) {
+        throw Exception("设置路由失败: " + std::string(modbus_strerror(errno)));
+    }
+    slot.mapping = nullptr;
+    slot.handler = std::move(handler);
+}
+
+void ModbusTCPServer::Router::remove(int unit_id) {
+    if (modbus_router_remove(impl_->router, unit_id) == -1) {
+        throw Exception("移除路由失败: " + std::string(modbus_strerror(errno)));
+    }
+    impl_->slots[unit_id].mapping = nullptr;
+    impl_->slots[unit_id].handler = nullptr;
+}
+
+// ModbusLoopback 实现
+ModbusLoopback::ModbusLoopback(ModbusTCPServer::Mapping& mapping)
+    : Modbus(std::make_unique<ModbusImpl>(modbus_new_loopback(mapping.impl_->mapping))) {}
+
+// 数据转换实现
+static void check_conversion(int rc) {
+    if (rc == -1) {
+        throw Exception("数据转换失败: " + std::string(modbus_strerror(errno)));
+    }
+}
+
+// nb_words 个寄存器的值，C 接口要求 nb * 2 * nb_words 不超过 INT_MAX
+static int conversion_count(size_t nb, int nb_words) {
+    if (nb > static_cast<size_t>(INT_MAX / (2 * nb_words))) {
+        throw Exception("数据转换失败: 数量过大", EINVAL);
+    }
+    return static_cast<int>(nb);
+}
+
+static modbus_order_t to_c_order(ByteOrder order) {
+    return static_cast<modbus_order_t>(static_cast<int>(order));
+}
+
+void decode_array(const uint16_t* src, float* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_get_float_array(src, dest, conversion_count(nb, 2), to_c_order(order)));
+}
+
+void decode_array(const uint16_t* src, double* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_get_double_array(src, dest, conversion_count(nb, 4), to_c_order(order)));
+}
+
+void decode_array(const uint16_t* src, int32_t* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_get_int32_array(src, dest, conversion_count(nb, 2), to_c_order(order)));
+}
+
+void decode_array(const uint16_t* src, uint32_t* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_get_uint32_array(src, dest, conversion_count(nb, 2), to_c_order(order)));
+}
+
+void decode_array(const uint16_t* src, int64_t* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_get_int64_array(src, dest, conversion_count(nb, 4), to_c_order(order)));
+}
+
+void decode_array(const uint16_t* src, uint64_t* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_get_uint64_array(src, dest, conversion_count(nb, 4), to_c_order(order)));
+}
+
+void encode_array(const float* src, uint16_t* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_set_float_array(src, dest, conversion_count(nb, 2), to_c_order(order)));
+}
+
+void encode_array(const double* src, uint16_t* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_set_double_array(src, dest, conversion_count(nb, 4), to_c_order(order)));
+}
+
+void encode_array(const int32_t* src, uint16_t* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_set_int32_array(src, dest, conversion_count(nb, 2), to_c_order(order)));
+}
+
+void encode_array(const uint32_t* src, uint16_t* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_set_uint32_array(src, dest, conversion_count(nb, 2), to_c_order(order)));
+}
+
+void encode_array(const int64_t* src, uint16_t* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_set_int64_array(src, dest, conversion_count(nb, 4), to_c_order(order)));
+}
+
+void encode_array(const uint64_t* src, uint16_t* dest, size_t nb, ByteOrder order) {
+    check_conversion(modbus_set_uint64_array(src, dest, conversion_count(nb, 4), to_c_order(order)));
+}
+
 // 版本信息函数
 std::string version() {
     return LIBMODBUS_VERSION_STRING;
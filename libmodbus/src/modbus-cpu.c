@@ -0,0 +1,67 @@
+/*
+ * libmodbus CPU features
+ * Copyright © 2025
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * Instruction set extensions used by the CRC16 folding and the array
+ * conversions. They are probed once by a constructor when the library is
+ * loaded, before any thread of the application can call the library, so the
+ * readers never race with the probe.
+ */
+
+#include "modbus-private.h"
+
+#if defined(HAVE_CRC16_PCLMUL) || defined(HAVE_DATA_SSSE3)
+#include <cpuid.h>
+#elif defined(HAVE_CRC16_PMULL)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#if defined(HAVE_CRC16_PCLMUL) || defined(HAVE_DATA_SSSE3) || defined(HAVE_CRC16_PMULL) || \
+    defined(HAVE_DATA_NEON)
+static int cpu_features;
+
+__attribute__((constructor)) static void cpu_probe(void)
+{
+    int features = 0;
+#if defined(HAVE_CRC16_PCLMUL) || defined(HAVE_DATA_SSSE3)
+    unsigned int eax, ebx, ecx, edx;
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+#if defined(HAVE_CRC16_PCLMUL)
+        if (ecx & bit_PCLMUL) {
+            features |= _MODBUS_CPU_CLMUL;
+        }
+#endif
+#if defined(HAVE_DATA_SSSE3)
+        if (ecx & bit_SSSE3) {
+            features |= _MODBUS_CPU_SHUFFLE;
+        }
+#endif
+    }
+#else
+#if defined(HAVE_CRC16_PMULL)
+    if (getauxval(AT_HWCAP) & HWCAP_PMULL) {
+        features |= _MODBUS_CPU_CLMUL;
+    }
+#endif
+#if defined(HAVE_DATA_NEON)
+    /* Part of the AArch64 base instruction set */
+    features |= _MODBUS_CPU_SHUFFLE;
+#endif
+#endif
+
+    cpu_features = features;
+}
+
+int _modbus_cpu_features(void)
+{
+    return cpu_features;
+}
+#else
+int _modbus_cpu_features(void)
+{
+    return 0;
+}
+#endif
@@ -13,8 +13,10 @@
 #  include "stdint.h"
 #endif
 
+#include <limits.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
 
 #if defined(_WIN32)
 #  include <winsock2.h>
@@ -24,19 +26,64 @@
 
 #include <config.h>
 
-#include "modbus-core.h"
+#include "modbus-private.h"
+
+#if defined(HAVE_DATA_SSSE3)
+#  include <tmmintrin.h>
+#elif defined(HAVE_DATA_NEON)
+#  include <arm_neon.h>
+#endif
 
 // clang-format on
 
-/* Sets many bits from a single byte value (all 8 bits of the byte value are
-   set) */
-void modbus_set_bits_from_byte(uint8_t *dest, int idx, const uint8_t value)
+/* Spreads the 8 bits of a byte over the 8 bytes of a word, bit i in the
+   lowest bit of byte i: the replicated byte is masked with a different bit
+   per lane and adding 0x7F carries any set bit to the top of its lane. */
+static uint64_t bits_spread(uint8_t value)
 {
+    uint64_t x = value * UINT64_C(0x0101010101010101);
+
+    x &= UINT64_C(0x8040201008040201);
+    return ((x + UINT64_C(0x7F7F7F7F7F7F7F7F)) >> 7) & UINT64_C(0x0101010101010101);
+}
+
+/* Inverse of bits_spread(), any non-zero byte counts as a set bit. The
+   multiplication moves the lowest bit of byte i to bit 56 + i without
+   carries between the partial products. */
+static uint8_t bits_gather(uint64_t x)
+{
+    x = (((x & UINT64_C(0x7F7F7F7F7F7F7F7F)) + UINT64_C(0x7F7F7F7F7F7F7F7F)) | x) >> 7;
+    x &= UINT64_C(0x0101010101010101);
+    return (uint8_t) ((x * UINT64_C(0x0102040810204080)) >> 56);
+}
+
+/* Byte i of the word is the byte at p[i] whatever the host endianness, the
+   compilers turn both loops into a plain load or store */
+static uint64_t bits_load(const uint8_t *p)
+{
+    uint64_t x = 0;
     int i;
 
     for (i = 0; i < 8; i++) {
-        dest[idx + i] = (value & (1 << i)) ? 1 : 0;
+        x |= (uint64_t) p[i] << (8 * i);
     }
+    return x;
+}
+
+static void bits_store(uint8_t *p, uint64_t x)
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        p[i] = (uint8_t) (x >> (8 * i));
+    }
+}
+
+/* Sets many bits from a single byte value (all 8 bits of the byte value are
+   set) */
+void modbus_set_bits_from_byte(uint8_t *dest, int idx, const uint8_t value)
+{
+    bits_store(dest + idx, bits_spread(value));
 }
 
 /* Sets many bits from a table of bytes (only the bits between idx and
@@ -47,13 +94,39 @@ void modbus_set_bits_from_bytes(uint8_t *dest,
                                 const uint8_t *tab_byte)
 {
     unsigned int i;
-    int shift = 0;
 
-    for (i = idx; i < idx + nb_bits; i++) {
-        dest[i] = tab_byte[(i - idx) / 8] & (1 << shift) ? 1 : 0;
-        /* gcc doesn't like: shift = (++shift) % 8; */
-        shift++;
-        shift %= 8;
+    dest += idx;
+    /* Eight bits at once, then the remaining ones */
+    for (i = 0; i + 8 <= nb_bits; i += 8) {
+        bits_store(dest + i, bits_spread(tab_byte[i / 8]));
+    }
+    for (; i < nb_bits; i++) {
+        dest[i] = (tab_byte[i / 8] >> (i % 8)) & 1;
+    }
+}
+
+/* Packs many bits (one byte per bit, non-zero is set) into a table of bytes,
+   the inverse of modbus_set_bits_from_bytes(). The unused bits of the last
+   byte are cleared. */
+void modbus_get_bytes_from_bits(const uint8_t *src,
+                                int idx,
+                                unsigned int nb_bits,
+                                uint8_t *tab_byte)
+{
+    unsigned int i;
+
+    src += idx;
+    for (i = 0; i + 8 <= nb_bits; i += 8) {
+        tab_byte[i / 8] = bits_gather(bits_load(src + i));
+    }
+    if (i < nb_bits) {
+        uint8_t *last = tab_byte + i / 8;
+        unsigned int shift;
+
+        *last = 0;
+        for (shift = 0; i < nb_bits; i++, shift++) {
+            *last |= (src[i] ? 1 : 0) << shift;
+        }
     }
 }
 
@@ -239,3 +312,201 @@ void modbus_set_float(float f, uint16_t *dest)
 {
     modbus_set_float_cdab(f, dest);
 }
+
+/* Array conversions
+
+   A value of nb_words registers is assembled from the most significant
+   register, taken from the end of the array for the DCBA and CDAB orders, the
+   bytes of each register being swapped for the DCBA and BADC orders. */
+
+static uint16_t data_swap16(uint16_t w)
+{
+    return (uint16_t) ((w << 8) | (w >> 8));
+}
+
+static uint64_t data_get(const uint16_t *src, int nb_words, modbus_order_t order)
+{
+    int reversed = order == MODBUS_ORDER_DCBA || order == MODBUS_ORDER_CDAB;
+    int swapped = order == MODBUS_ORDER_DCBA || order == MODBUS_ORDER_BADC;
+    uint64_t value = 0;
+    int k;
+
+    for (k = 0; k < nb_words; k++) {
+        uint16_t w = src[reversed ? nb_words - 1 - k : k];
+        value = (value << 16) | (swapped ? data_swap16(w) : w);
+    }
+
+    return value;
+}
+
+static void data_set(uint64_t value, uint16_t *dest, int nb_words, modbus_order_t order)
+{
+    int reversed = order == MODBUS_ORDER_DCBA || order == MODBUS_ORDER_CDAB;
+    int swapped = order == MODBUS_ORDER_DCBA || order == MODBUS_ORDER_BADC;
+    int k;
+
+    for (k = nb_words - 1; k >= 0; k--) {
+        uint16_t w = (uint16_t) value;
+        dest[reversed ? nb_words - 1 - k : k] = swapped ? data_swap16(w) : w;
+        value >>= 16;
+    }
+}
+
+#if defined(HAVE_DATA_SSSE3) || defined(HAVE_DATA_NEON)
+/* On a little-endian host, every conversion is a permutation of the bytes of
+   each value (its own inverse, so the same one is used in both directions).
+   Indexed by the size of the value (32 or 64 bits) then by the order. */
+static const uint8_t data_masks[2][4][16] = {
+    {
+        {2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13},
+        {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14},
+        {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},
+        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    },
+    {
+        {6, 7, 4, 5, 2, 3, 0, 1, 14, 15, 12, 13, 10, 11, 8, 9},
+        {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14},
+        {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8},
+        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    },
+};
+#endif
+
+#if defined(HAVE_DATA_SSSE3)
+__attribute__((target("ssse3"))) static void
+data_shuffle(const uint8_t *src, uint8_t *dest, int nb_blocks, const uint8_t *mask)
+{
+    const __m128i m = _mm_loadu_si128((const __m128i *) mask);
+    int i;
+
+    for (i = 0; i < nb_blocks; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (src + 16 * i));
+        _mm_storeu_si128((__m128i *) (dest + 16 * i), _mm_shuffle_epi8(v, m));
+    }
+}
+
+#elif defined(HAVE_DATA_NEON)
+static void
+data_shuffle(const uint8_t *src, uint8_t *dest, int nb_blocks, const uint8_t *mask)
+{
+    const uint8x16_t m = vld1q_u8(mask);
+    int i;
+
+    for (i = 0; i < nb_blocks; i++) {
+        vst1q_u8(dest + 16 * i, vqtbl1q_u8(vld1q_u8(src + 16 * i), m));
+    }
+}
+#endif
+
+#if defined(HAVE_DATA_SSSE3) || defined(HAVE_DATA_NEON)
+static int data_shuffle_supported(void)
+{
+    return (_modbus_cpu_features() & _MODBUS_CPU_SHUFFLE) != 0;
+}
+#endif
+
+/* Converts nb values of nb_words registers, from the registers in src to the
+   host values in dest when decode is set, the other way otherwise */
+static int data_convert(
+    const void *src, void *dest, int nb, int nb_words, modbus_order_t order, int decode)
+{
+    const int size = 2 * nb_words;
+    int i = 0;
+
+    /* nb * size must fit in an int */
+    if (nb < 0 || nb > INT_MAX / size || (nb > 0 && (src == NULL || dest == NULL)) ||
+        (unsigned int) order > MODBUS_ORDER_CDAB) {
+        errno = EINVAL;
+        return -1;
+    }
+
+#if defined(HAVE_DATA_SSSE3) || defined(HAVE_DATA_NEON)
+    if (nb * size >= 16 && data_shuffle_supported()) {
+        int nb_blocks = nb * size / 16;
+
+        data_shuffle(src, dest, nb_blocks, data_masks[nb_words == 4][order]);
+        i = nb_blocks * 16 / size;
+    }
+#endif
+
+    for (; i < nb; i++) {
+        uint64_t value;
+        uint32_t value32;
+
+        if (decode) {
+            value = data_get((const uint16_t *) src + (size_t) nb_words * i, nb_words, order);
+            value32 = (uint32_t) value;
+            memcpy((uint8_t *) dest + (size_t) size * i,
+                   nb_words == 2 ? (void *) &value32 : &value,
+                   size);
+        } else if (nb_words == 2) {
+            memcpy(&value32, (const uint8_t *) src + (size_t) size * i, size);
+            data_set(value32, (uint16_t *) dest + (size_t) nb_words * i, nb_words, order);
+        } else {
+            memcpy(&value, (const uint8_t *) src + (size_t) size * i, size);
+            data_set(value, (uint16_t *) dest + (size_t) nb_words * i, nb_words, order);
+        }
+    }
+
+    return 0;
+}
+
+int modbus_get_float_array(const uint16_t *src, float *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 2, order, 1);
+}
+
+int modbus_get_double_array(const uint16_t *src, double *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 4, order, 1);
+}
+
+int modbus_get_int32_array(const uint16_t *src, int32_t *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 2, order, 1);
+}
+
+int modbus_get_uint32_array(const uint16_t *src, uint32_t *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 2, order, 1);
+}
+
+int modbus_get_int64_array(const uint16_t *src, int64_t *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 4, order, 1);
+}
+
+int modbus_get_uint64_array(const uint16_t *src, uint64_t *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 4, order, 1);
+}
+
+int modbus_set_float_array(const float *src, uint16_t *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 2, order, 0);
+}
+
+int modbus_set_double_array(const double *src, uint16_t *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 4, order, 0);
+}
+
+int modbus_set_int32_array(const int32_t *src, uint16_t *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 2, order, 0);
+}
+
+int modbus_set_uint32_array(const uint32_t *src, uint16_t *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 2, order, 0);
+}
+
+int modbus_set_int64_array(const int64_t *src, uint16_t *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 4, order, 0);
+}
+
+int modbus_set_uint64_array(const uint64_t *src, uint16_t *dest, int nb, modbus_order_t order)
+{
+    return data_convert(src, dest, nb, 4, order, 0);
+}
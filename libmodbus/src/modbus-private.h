@@ -43,7 +43,9 @@ MODBUS_BEGIN_DECLS
 
 typedef enum {
     _MODBUS_BACKEND_TYPE_RTU = 0,
-    _MODBUS_BACKEND_TYPE_TCP
+    _MODBUS_BACKEND_TYPE_TCP,
+    /* RTU framing over a TCP connection */
+    _MODBUS_BACKEND_TYPE_RTU_TCP
 } modbus_backend_type_t;
 
 /*
@@ -91,6 +93,9 @@ typedef struct _modbus_backend {
     int (*flush)(modbus_t *ctx);
     int (*select)(modbus_t *ctx, fd_set *rset, struct timeval *tv, int msg_length);
     void (*free)(modbus_t *ctx);
+    /* Optional, returns the line silence in microseconds which ends a frame or
+       0 to compute the message length from its content */
+    int (*frame_silence)(modbus_t *ctx);
 } modbus_backend_t;
 
 struct _modbus {
@@ -111,6 +116,26 @@ struct _modbus {
 void _modbus_init_common(modbus_t *ctx);
 void _error_print(modbus_t *ctx, const char *context);
 int _modbus_receive_msg(modbus_t *ctx, uint8_t *msg, msg_type_t msg_type);
+int _modbus_check_confirmation(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp_length);
+int _modbus_check_response(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp_length);
+int _modbus_response_length(modbus_t *ctx, uint8_t *req);
+
+/* CRC-16/MODBUS, low byte is the first one to send (see modbus-crc16.c) */
+uint16_t _modbus_crc16(const uint8_t *buffer, uint16_t buffer_length);
+uint16_t _modbus_crc16_bytewise(const uint8_t *buffer, uint16_t buffer_length);
+uint16_t _modbus_crc16_slice8(const uint8_t *buffer, uint16_t buffer_length);
+uint16_t _modbus_crc16_clmul(const uint8_t *buffer, uint16_t buffer_length);
+int _modbus_crc16_has_clmul(void);
+
+/* Instruction set extensions of the CPU, probed once when the library is
+   loaded (see modbus-cpu.c) */
+#define _MODBUS_CPU_CLMUL   (1 << 0) /* PCLMULQDQ or ARMv8 PMULL */
+#define _MODBUS_CPU_SHUFFLE (1 << 1) /* SSSE3 PSHUFB or AArch64 TBL */
+int _modbus_cpu_features(void);
+
+#if HAVE_DECL_BOTHER
+int _modbus_rtu_set_custom_baud(int fd, int baud);
+#endif
 
 #ifndef HAVE_STRLCPY
 size_t strlcpy(char *dest, const char *src, size_t dest_size);
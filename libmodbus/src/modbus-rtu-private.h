@@ -72,6 +72,35 @@ typedef struct _modbus_rtu {
 #endif
     /* To handle many slaves on the same link */
     int confirmation_to_ignore;
+    /* Additional slave addresses answered by a server (one bit per address) */
+    uint8_t slaves[32];
+    /* MODBUS_RTU_FRAME_LENGTH or MODBUS_RTU_FRAME_SILENCE */
+    int frame_detection;
+    /* Silence ending a frame in microseconds, 0 to derive t3.5 from the baud rate */
+    int frame_silence;
+    /* MODBUS_RTU_DRAIN_SLEEP, MODBUS_RTU_DRAIN_TCDRAIN or MODBUS_RTU_DRAIN_LSR */
+    int drain_mode;
+    /* Turnaround measures in microseconds */
+    unsigned int nb_turnarounds;
+    int64_t turnaround_min;
+    int64_t turnaround_max;
+    int64_t turnaround_sum;
+    /* Enforces the t3.5 gap before sending a frame */
+    int frame_gap;
+#if !defined(_WIN32)
+    /* End of the last frame seen on the bus (sent or received) */
+    struct timespec last_frame_end;
+    /* First activity since the statistics were reset */
+    struct timespec bus_start;
+    int bus_active;
+    /* Time spent by frames on the wire in microseconds */
+    int64_t bus_busy;
+    /* Reads everything available and frames from this buffer */
+    int buffered_read;
+    uint8_t rbuf[MODBUS_RTU_MAX_ADU_LENGTH];
+    int rbuf_start;
+    int rbuf_end;
+#endif
 } modbus_rtu_t;
 
 #endif /* MODBUS_RTU_PRIVATE_H */
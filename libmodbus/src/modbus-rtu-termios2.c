@@ -0,0 +1,42 @@
+/*
+ * libmodbus RTU arbitrary baud rates
+ * Copyright © 2025
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * Linux termios2 interface: any baud rate supported by the UART driver can be
+ * set with the BOTHER flag. It lives in its own file because <asm/termbits.h>
+ * conflicts with <termios.h>.
+ */
+
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+
+#include "modbus-private.h"
+
+/* Sets the input and output baud rate of fd to baud. Returns the rate
+   actually applied by the driver (it may be rounded to what the UART clock
+   divisor allows) or -1 on error (errno is set by ioctl). */
+int _modbus_rtu_set_custom_baud(int fd, int baud)
+{
+    struct termios2 tios2;
+
+    if (ioctl(fd, TCGETS2, &tios2) < 0) {
+        return -1;
+    }
+
+    tios2.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+    tios2.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    tios2.c_ispeed = baud;
+    tios2.c_ospeed = baud;
+
+    if (ioctl(fd, TCSETS2, &tios2) < 0) {
+        return -1;
+    }
+
+    /* Read back the rate set by the driver */
+    if (ioctl(fd, TCGETS2, &tios2) < 0) {
+        return -1;
+    }
+
+    return tios2.c_ospeed ? (int) tios2.c_ospeed : baud;
+}
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
@@ -18,7 +19,7 @@
 #include "modbus-rtu-private.h"
 #include "modbus-rtu.h"
 
-#if HAVE_DECL_TIOCSRS485 || HAVE_DECL_TIOCM_RTS
+#if HAVE_DECL_TIOCSRS485 || HAVE_DECL_TIOCM_RTS || HAVE_DECL_TIOCSERGETLSR
 #include <sys/ioctl.h>
 #endif
 
@@ -26,50 +27,6 @@
 #include <linux/serial.h>
 #endif
 
-/* Table of CRC values for high-order byte */
-static const uint8_t table_crc_hi[] = {
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1,
-    0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40,
-    0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1,
-    0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1,
-    0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1,
-    0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0,
-    0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40,
-    0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0,
-    0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1,
-    0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0,
-    0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0,
-    0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40};
-
-/* Table of CRC values for low-order byte */
-static const uint8_t table_crc_lo[] = {
-    0x00, 0xC0, 0xC1, 0x01, 0xC3, 0x03, 0x02, 0xC2, 0xC6, 0x06, 0x07, 0xC7, 0x05, 0xC5,
-    0xC4, 0x04, 0xCC, 0x0C, 0x0D, 0xCD, 0x0F, 0xCF, 0xCE, 0x0E, 0x0A, 0xCA, 0xCB, 0x0B,
-    0xC9, 0x09, 0x08, 0xC8, 0xD8, 0x18, 0x19, 0xD9, 0x1B, 0xDB, 0xDA, 0x1A, 0x1E, 0xDE,
-    0xDF, 0x1F, 0xDD, 0x1D, 0x1C, 0xDC, 0x14, 0xD4, 0xD5, 0x15, 0xD7, 0x17, 0x16, 0xD6,
-    0xD2, 0x12, 0x13, 0xD3, 0x11, 0xD1, 0xD0, 0x10, 0xF0, 0x30, 0x31, 0xF1, 0x33, 0xF3,
-    0xF2, 0x32, 0x36, 0xF6, 0xF7, 0x37, 0xF5, 0x35, 0x34, 0xF4, 0x3C, 0xFC, 0xFD, 0x3D,
-    0xFF, 0x3F, 0x3E, 0xFE, 0xFA, 0x3A, 0x3B, 0xFB, 0x39, 0xF9, 0xF8, 0x38, 0x28, 0xE8,
-    0xE9, 0x29, 0xEB, 0x2B, 0x2A, 0xEA, 0xEE, 0x2E, 0x2F, 0xEF, 0x2D, 0xED, 0xEC, 0x2C,
-    0xE4, 0x24, 0x25, 0xE5, 0x27, 0xE7, 0xE6, 0x26, 0x22, 0xE2, 0xE3, 0x23, 0xE1, 0x21,
-    0x20, 0xE0, 0xA0, 0x60, 0x61, 0xA1, 0x63, 0xA3, 0xA2, 0x62, 0x66, 0xA6, 0xA7, 0x67,
-    0xA5, 0x65, 0x64, 0xA4, 0x6C, 0xAC, 0xAD, 0x6D, 0xAF, 0x6F, 0x6E, 0xAE, 0xAA, 0x6A,
-    0x6B, 0xAB, 0x69, 0xA9, 0xA8, 0x68, 0x78, 0xB8, 0xB9, 0x79, 0xBB, 0x7B, 0x7A, 0xBA,
-    0xBE, 0x7E, 0x7F, 0xBF, 0x7D, 0xBD, 0xBC, 0x7C, 0xB4, 0x74, 0x75, 0xB5, 0x77, 0xB7,
-    0xB6, 0x76, 0x72, 0xB2, 0xB3, 0x73, 0xB1, 0x71, 0x70, 0xB0, 0x50, 0x90, 0x91, 0x51,
-    0x93, 0x53, 0x52, 0x92, 0x96, 0x56, 0x57, 0x97, 0x55, 0x95, 0x94, 0x54, 0x9C, 0x5C,
-    0x5D, 0x9D, 0x5F, 0x9F, 0x9E, 0x5E, 0x5A, 0x9A, 0x9B, 0x5B, 0x99, 0x59, 0x58, 0x98,
-    0x88, 0x48, 0x49, 0x89, 0x4B, 0x8B, 0x8A, 0x4A, 0x4E, 0x8E, 0x8F, 0x4F, 0x8D, 0x4D,
-    0x4C, 0x8C, 0x44, 0x84, 0x85, 0x45, 0x87, 0x47, 0x46, 0x86, 0x82, 0x42, 0x43, 0x83,
-    0x41, 0x81, 0x80, 0x40};
-
 /* Define the slave ID of the remote device to talk in master mode or set the
  * internal slave ID in slave mode */
 static int _modbus_set_slave(modbus_t *ctx, int slave)
@@ -113,20 +70,45 @@ static int _modbus_rtu_build_response_basis(sft_t *sft, uint8_t *rsp)
     return _MODBUS_RTU_PRESET_RSP_LENGTH;
 }
 
-static uint16_t crc16(uint8_t *buffer, uint16_t buffer_length)
+/* Computes the timings derived from the baud rate */
+static void _modbus_rtu_update_timings(modbus_rtu_t *ctx_rtu)
+{
+#if HAVE_DECL_TIOCM_RTS
+    int char_bits = 1 + ctx_rtu->data_bit + (ctx_rtu->parity == 'N' ? 0 : 1) +
+                    ctx_rtu->stop_bit;
+    int default_rts_delay = (ctx_rtu->rts_delay == ctx_rtu->onebyte_time);
+
+    /* Estimated time in micro second to send one byte, rounded up so high
+       rates (3.3 us at 3 Mbauds) aren't underestimated */
+    ctx_rtu->onebyte_time = (char_bits * 1000000 + ctx_rtu->baud - 1) / ctx_rtu->baud;
+
+    /* The delay before and after transmission when toggling the RTS pin,
+       unless defined by the user */
+    if (default_rts_delay) {
+        ctx_rtu->rts_delay = ctx_rtu->onebyte_time;
+    }
+#else
+    (void) ctx_rtu;
+#endif
+}
+
+/* Inter-frame silence (t3.5) in microseconds. The Modbus over serial line
+   specification fixes it to 1750 us above 19200 bauds. */
+static int _modbus_rtu_silence_time(modbus_rtu_t *ctx_rtu)
 {
-    uint8_t crc_hi = 0xFF; /* high CRC byte initialized */
-    uint8_t crc_lo = 0xFF; /* low CRC byte initialized */
-    unsigned int i;        /* will index into CRC lookup */
+    int char_bits;
 
-    /* pass through message buffer */
-    while (buffer_length--) {
-        i = crc_lo ^ *buffer++; /* calculate the CRC  */
-        crc_lo = crc_hi ^ table_crc_hi[i];
-        crc_hi = table_crc_lo[i];
+    if (ctx_rtu->frame_silence > 0) {
+        return ctx_rtu->frame_silence;
     }
 
-    return (crc_hi << 8 | crc_lo);
+    if (ctx_rtu->baud > 19200) {
+        return 1750;
+    }
+
+    char_bits = 1 + ctx_rtu->data_bit + (ctx_rtu->parity == 'N' ? 0 : 1) + ctx_rtu->stop_bit;
+    /* 3.5 characters rounded up */
+    return (7 * char_bits * 1000000 + 2 * ctx_rtu->baud - 1) / (2 * ctx_rtu->baud);
 }
 
 static int _modbus_rtu_get_response_tid(const uint8_t *req)
@@ -137,7 +119,7 @@ static int _modbus_rtu_get_response_tid(const uint8_t *req)
 
 static int _modbus_rtu_send_msg_pre(uint8_t *req, int req_length)
 {
-    uint16_t crc = crc16(req, req_length);
+    uint16_t crc = _modbus_crc16(req, req_length);
 
     /* According to the MODBUS specs (p. 14), the low order byte of the CRC comes
      * first in the RTU message */
@@ -251,6 +233,151 @@ static void _modbus_rtu_ioctl_rts(modbus_t *ctx, int on)
 }
 #endif
 
+#if !defined(_WIN32)
+static int64_t _modbus_rtu_elapsed_us(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) (now.tv_sec - start->tv_sec) * 1000000 +
+           (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+static void _modbus_rtu_add_us(struct timespec *ts, int64_t us)
+{
+    ts->tv_sec += us / 1000000;
+    ts->tv_nsec += (us % 1000000) * 1000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    } else if (ts->tv_nsec < 0) {
+        ts->tv_sec--;
+        ts->tv_nsec += 1000000000;
+    }
+}
+
+static int _modbus_rtu_timespec_before(const struct timespec *a, const struct timespec *b)
+{
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+/* Time to transmit length characters in microseconds */
+static int64_t _modbus_rtu_wire_time(modbus_rtu_t *ctx_rtu, int length)
+{
+    int char_bits = 1 + ctx_rtu->data_bit + (ctx_rtu->parity == 'N' ? 0 : 1) +
+                    ctx_rtu->stop_bit;
+
+    return (int64_t) length * char_bits * 1000000 / ctx_rtu->baud;
+}
+
+/* Accounts a frame which ends at frame_end on the bus */
+static void _modbus_rtu_add_bus_activity(modbus_rtu_t *ctx_rtu,
+                                         const struct timespec *frame_end,
+                                         int length)
+{
+    int64_t wire_time = _modbus_rtu_wire_time(ctx_rtu, length);
+
+    if (!ctx_rtu->bus_active) {
+        ctx_rtu->bus_start = *frame_end;
+        _modbus_rtu_add_us(&ctx_rtu->bus_start, -wire_time);
+        ctx_rtu->bus_active = TRUE;
+    }
+    if (_modbus_rtu_timespec_before(&ctx_rtu->last_frame_end, frame_end)) {
+        ctx_rtu->last_frame_end = *frame_end;
+    }
+    ctx_rtu->bus_busy += wire_time;
+}
+
+/* Sleeps until t3.5 elapsed since the end of the last frame on the bus, so
+   consecutive requests (to the same or to different slaves) are packed
+   with the minimum gap allowed by the specification */
+static void _modbus_rtu_wait_frame_gap(modbus_rtu_t *ctx_rtu)
+{
+    struct timespec deadline = ctx_rtu->last_frame_end;
+    struct timespec now;
+
+    _modbus_rtu_add_us(&deadline, _modbus_rtu_silence_time(ctx_rtu));
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (!_modbus_rtu_timespec_before(&now, &deadline)) {
+        return;
+    }
+
+#if HAVE_CLOCK_NANOSLEEP
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+        ;
+#else
+    {
+        struct timespec request;
+
+        request.tv_sec = deadline.tv_sec - now.tv_sec;
+        request.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+        if (request.tv_nsec < 0) {
+            request.tv_sec--;
+            request.tv_nsec += 1000000000;
+        }
+        while (nanosleep(&request, &request) == -1 && errno == EINTR)
+            ;
+    }
+#endif
+}
+
+/* Waits for the transmitter to send the last bit of the frame */
+static void _modbus_rtu_wait_sent(modbus_t *ctx, int req_length)
+{
+    modbus_rtu_t *ctx_rtu = ctx->backend_data;
+
+    switch (ctx_rtu->drain_mode) {
+    case MODBUS_RTU_DRAIN_TCDRAIN:
+        tcdrain(ctx->s);
+        break;
+#if HAVE_DECL_TIOCSERGETLSR
+    case MODBUS_RTU_DRAIN_LSR: {
+        struct timespec start;
+        unsigned int lsr;
+
+        /* Many drivers return from tcdrain() when the FIFO is empty but the
+           shift register still holds the last character */
+        tcdrain(ctx->s);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        while (ioctl(ctx->s, TIOCSERGETLSR, &lsr) == 0 && !(lsr & TIOCSER_TEMT)) {
+            /* Bounded to a few characters if the driver misreports */
+            if (_modbus_rtu_elapsed_us(&start) > 4 * 1000000 * 12 / ctx_rtu->baud + 1000) {
+                break;
+            }
+        }
+    } break;
+#endif
+    default:
+#if HAVE_DECL_TIOCM_RTS
+        usleep(ctx_rtu->onebyte_time * req_length + ctx_rtu->rts_delay);
+#endif
+        break;
+    }
+}
+
+/* Records the time spent after the frame left the wire before the line was
+   released */
+static void
+_modbus_rtu_add_turnaround(modbus_rtu_t *ctx_rtu, const struct timespec *start, int length)
+{
+    int64_t turnaround = _modbus_rtu_elapsed_us(start) - _modbus_rtu_wire_time(ctx_rtu, length);
+
+    if (turnaround < 0) {
+        /* write() returned after the data left, the kernel buffered nothing */
+        turnaround = 0;
+    }
+
+    if (ctx_rtu->nb_turnarounds == 0 || turnaround < ctx_rtu->turnaround_min) {
+        ctx_rtu->turnaround_min = turnaround;
+    }
+    if (ctx_rtu->nb_turnarounds == 0 || turnaround > ctx_rtu->turnaround_max) {
+        ctx_rtu->turnaround_max = turnaround;
+    }
+    ctx_rtu->turnaround_sum += turnaround;
+    ctx_rtu->nb_turnarounds++;
+}
+#endif
+
 static ssize_t _modbus_rtu_send(modbus_t *ctx, const uint8_t *req, int req_length)
 {
 #if defined(_WIN32)
@@ -260,30 +387,60 @@ static ssize_t _modbus_rtu_send(modbus_t *ctx, const uint8_t *req, int req_lengt
                ? (ssize_t) n_bytes
                : -1;
 #else
-#if HAVE_DECL_TIOCM_RTS
     modbus_rtu_t *ctx_rtu = ctx->backend_data;
-    if (ctx_rtu->rts != MODBUS_RTU_RTS_NONE) {
-        ssize_t size;
+    int use_rts = FALSE;
+    struct timespec start;
+    struct timespec frame_end;
+    ssize_t size;
+
+    if (ctx_rtu->frame_gap && ctx_rtu->bus_active) {
+        _modbus_rtu_wait_frame_gap(ctx_rtu);
+    }
 
+#if HAVE_DECL_TIOCM_RTS
+    if (ctx_rtu->rts != MODBUS_RTU_RTS_NONE) {
         if (ctx->debug) {
             fprintf(stderr, "Sending request using RTS signal\n");
         }
 
         ctx_rtu->set_rts(ctx, ctx_rtu->rts == MODBUS_RTU_RTS_UP);
         usleep(ctx_rtu->rts_delay);
+        use_rts = TRUE;
+    }
+#endif
 
-        size = write(ctx->s, req, req_length);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size = write(ctx->s, req, req_length);
+    if (size <= 0) {
+        return size;
+    }
 
-        usleep(ctx_rtu->onebyte_time * req_length + ctx_rtu->rts_delay);
-        ctx_rtu->set_rts(ctx, ctx_rtu->rts != MODBUS_RTU_RTS_UP);
+    /* The frame leaves the wire once its characters are shifted out after the
+       last frame (the transmitter may still be busy with it) */
+    frame_end = start;
+    if (_modbus_rtu_timespec_before(&frame_end, &ctx_rtu->last_frame_end)) {
+        frame_end = ctx_rtu->last_frame_end;
+    }
+    _modbus_rtu_add_us(&frame_end, _modbus_rtu_wire_time(ctx_rtu, size));
+    _modbus_rtu_add_bus_activity(ctx_rtu, &frame_end, size);
 
+    /* Without RTS (or with the kernel RS-485 mode), the end of the
+       transmission is only awaited to measure the turnaround */
+    if (!use_rts && ctx_rtu->drain_mode == MODBUS_RTU_DRAIN_SLEEP) {
         return size;
-    } else {
-#endif
-        return write(ctx->s, req, req_length);
+    }
+
+    _modbus_rtu_wait_sent(ctx, size);
+
 #if HAVE_DECL_TIOCM_RTS
+    if (use_rts) {
+        ctx_rtu->set_rts(ctx, ctx_rtu->rts != MODBUS_RTU_RTS_UP);
     }
 #endif
+
+    _modbus_rtu_add_turnaround(ctx_rtu, &start, size);
+
+    return size;
 #endif
 }
 
@@ -315,7 +472,47 @@ static ssize_t _modbus_rtu_recv(modbus_t *ctx, uint8_t *rsp, int rsp_length)
 #if defined(_WIN32)
     return win32_ser_read(&((modbus_rtu_t *) ctx->backend_data)->w_ser, rsp, rsp_length);
 #else
-    return read(ctx->s, rsp, rsp_length);
+    modbus_rtu_t *ctx_rtu = ctx->backend_data;
+    ssize_t rc;
+
+    if (ctx_rtu->rbuf_start < ctx_rtu->rbuf_end) {
+        /* Bytes read ahead */
+        rc = ctx_rtu->rbuf_end - ctx_rtu->rbuf_start;
+        if (rc > rsp_length) {
+            rc = rsp_length;
+        }
+        memcpy(rsp, ctx_rtu->rbuf + ctx_rtu->rbuf_start, rc);
+        ctx_rtu->rbuf_start += rc;
+        return rc;
+    }
+
+    /* The silence framing reads whole frames and must see the gaps itself */
+    if (ctx_rtu->buffered_read && ctx_rtu->frame_detection == MODBUS_RTU_FRAME_LENGTH &&
+        rsp_length < (int) sizeof(ctx_rtu->rbuf)) {
+        rc = read(ctx->s, ctx_rtu->rbuf, sizeof(ctx_rtu->rbuf));
+        if (rc > rsp_length) {
+            memcpy(rsp, ctx_rtu->rbuf, rsp_length);
+            ctx_rtu->rbuf_start = rsp_length;
+            ctx_rtu->rbuf_end = rc;
+        } else if (rc > 0) {
+            memcpy(rsp, ctx_rtu->rbuf, rc);
+        }
+    } else {
+        rc = read(ctx->s, rsp, rsp_length);
+    }
+
+    if (rc > 0) {
+        /* The last character has just been received */
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        _modbus_rtu_add_bus_activity(ctx_rtu, &now, rc);
+        if (rc > rsp_length) {
+            rc = rsp_length;
+        }
+    }
+
+    return rc;
 #endif
 }
 
@@ -350,8 +547,9 @@ static int _modbus_rtu_check_integrity(modbus_t *ctx, uint8_t *msg, const int ms
     uint16_t crc_calculated;
     uint16_t crc_received;
     int slave = msg[0];
+    modbus_rtu_t *ctx_rtu = ctx->backend_data;
 
-    crc_calculated = crc16(msg, msg_length - 2);
+    crc_calculated = _modbus_crc16(msg, msg_length - 2);
     crc_received = (msg[msg_length - 1] << 8) | msg[msg_length - 2];
 
     /* Check CRC of msg */
@@ -370,8 +568,10 @@ static int _modbus_rtu_check_integrity(modbus_t *ctx, uint8_t *msg, const int ms
         return -1;
     }
 
-    /* Filter on the Modbus unit identifier (slave) in RTU mode */
-    if (slave != ctx->slave && slave != MODBUS_BROADCAST_ADDRESS) {
+    /* Filter on the Modbus unit identifier (slave) in RTU mode, a server can
+       answer a set of addresses (see modbus_rtu_add_slave()) */
+    if (slave != ctx->slave && slave != MODBUS_BROADCAST_ADDRESS &&
+        !(ctx_rtu->slaves[slave >> 3] & (1 << (slave & 7)))) {
         if (ctx->debug) {
             printf("Request for slave %d ignored (not %d)\n", slave, ctx->slave);
         }
@@ -607,9 +807,14 @@ static speed_t _get_termios_speed(int baud, int debug)
 #endif
     default:
         speed = B9600;
+#if HAVE_DECL_BOTHER
+        /* The real rate is set afterwards with termios2 */
+        (void) debug;
+#else
         if (debug) {
             fprintf(stderr, "WARNING Unknown baud rate %d (B9600 used)\n", baud);
         }
+#endif
     }
 
     return speed;
@@ -658,6 +863,10 @@ static int _modbus_rtu_connect(modbus_t *ctx)
     /* Save */
     tcgetattr(ctx->s, &ctx_rtu->old_tios);
 
+    /* Nothing read ahead on the new line */
+    ctx_rtu->rbuf_start = 0;
+    ctx_rtu->rbuf_end = 0;
+
     memset(&tios, 0, sizeof(struct termios));
 
     /* C_ISPEED     Input baud (new interface)
@@ -858,6 +1067,34 @@ static int _modbus_rtu_connect(modbus_t *ctx)
         return -1;
     }
 
+#if HAVE_DECL_BOTHER
+    /* Rates without Bxxx constant (250k, 1M, 3M...) */
+    if (speed == B9600 && ctx_rtu->baud != 9600) {
+        int baud = _modbus_rtu_set_custom_baud(ctx->s, ctx_rtu->baud);
+
+        if (baud < 0) {
+            if (ctx->debug) {
+                fprintf(stderr,
+                        "ERROR Can't set %d bauds (%s)\n",
+                        ctx_rtu->baud,
+                        strerror(errno));
+            }
+            close(ctx->s);
+            ctx->s = -1;
+            return -1;
+        }
+
+        if (baud != ctx_rtu->baud) {
+            if (ctx->debug) {
+                printf("Baud rate %d rounded to %d by the driver\n", ctx_rtu->baud, baud);
+            }
+            /* Timings are derived from the real rate */
+            ctx_rtu->baud = baud;
+            _modbus_rtu_update_timings(ctx_rtu);
+        }
+    }
+#endif
+
     return 0;
 }
 #endif
@@ -1089,94 +1326,1048 @@ int modbus_rtu_set_rts_delay(modbus_t *ctx, int us)
     }
 }
 
-static void _modbus_rtu_close(modbus_t *ctx)
+/* Selects how the end of a transmission is awaited before releasing RTS:
+   - MODBUS_RTU_DRAIN_SLEEP estimates it from the baud rate (default);
+   - MODBUS_RTU_DRAIN_TCDRAIN waits for the driver to drain its buffers;
+   - MODBUS_RTU_DRAIN_LSR also polls the line status register until the
+     transmitter is empty (Linux).
+   In both precise modes the RTS delay is only applied before the
+   transmission. With the kernel RS-485 mode (modbus_rtu_set_serial_mode()),
+   the driver switches the direction itself and these modes only measure the
+   turnaround. */
+int modbus_rtu_set_drain_mode(modbus_t *ctx, int mode)
 {
-    /* Restore line settings and close file descriptor in RTU mode */
-    modbus_rtu_t *ctx_rtu = ctx->backend_data;
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
 
+    if (ctx->backend->backend_type == _MODBUS_BACKEND_TYPE_RTU) {
 #if defined(_WIN32)
-    /* Revert settings */
-    if (!SetCommState(ctx_rtu->w_ser.fd, &ctx_rtu->old_dcb) && ctx->debug) {
-        fprintf(stderr,
-                "ERROR Couldn't revert to configuration (LastError %d)\n",
-                (int) GetLastError());
+        if (ctx->debug) {
+            fprintf(stderr, "This function isn't supported on your platform\n");
+        }
+        errno = ENOTSUP;
+        return -1;
+#else
+        modbus_rtu_t *ctx_rtu = ctx->backend_data;
+
+        if (mode == MODBUS_RTU_DRAIN_SLEEP || mode == MODBUS_RTU_DRAIN_TCDRAIN) {
+            ctx_rtu->drain_mode = mode;
+            return 0;
+        } else if (mode == MODBUS_RTU_DRAIN_LSR) {
+#if HAVE_DECL_TIOCSERGETLSR
+            ctx_rtu->drain_mode = mode;
+            return 0;
+#else
+            if (ctx->debug) {
+                fprintf(stderr, "This function isn't supported on your platform\n");
+            }
+            errno = ENOTSUP;
+            return -1;
+#endif
+        }
+#endif
     }
 
-    if (!CloseHandle(ctx_rtu->w_ser.fd) && ctx->debug) {
-        fprintf(stderr,
-                "ERROR Error while closing handle (LastError %d)\n",
-                (int) GetLastError());
+    /* Wrong backend or invalid mode specified */
+    errno = EINVAL;
+    return -1;
+}
+
+int modbus_rtu_get_drain_mode(modbus_t *ctx)
+{
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
     }
-#else
-    if (ctx->s >= 0) {
-        tcsetattr(ctx->s, TCSANOW, &ctx_rtu->old_tios);
-        close(ctx->s);
-        ctx->s = -1;
+
+    if (ctx->backend->backend_type == _MODBUS_BACKEND_TYPE_RTU) {
+        modbus_rtu_t *ctx_rtu = ctx->backend_data;
+        return ctx_rtu->drain_mode;
     }
-#endif
+
+    errno = EINVAL;
+    return -1;
 }
 
-static int _modbus_rtu_flush(modbus_t *ctx)
+/* Enforces the t3.5 inter-frame gap, and no more, before each sent frame
+   using the monotonic clock. The end of the last frame is taken from the
+   sent and received characters. */
+int modbus_rtu_set_frame_gap(modbus_t *ctx, int enable)
 {
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (ctx->backend->backend_type == _MODBUS_BACKEND_TYPE_RTU) {
 #if defined(_WIN32)
-    modbus_rtu_t *ctx_rtu = ctx->backend_data;
-    ctx_rtu->w_ser.n_bytes = 0;
-    return (PurgeComm(ctx_rtu->w_ser.fd, PURGE_RXCLEAR) == FALSE);
+        if (ctx->debug) {
+            fprintf(stderr, "This function isn't supported on your platform\n");
+        }
+        errno = ENOTSUP;
+        return -1;
 #else
-    return tcflush(ctx->s, TCIOFLUSH);
+        modbus_rtu_t *ctx_rtu = ctx->backend_data;
+        ctx_rtu->frame_gap = enable ? TRUE : FALSE;
+        return 0;
 #endif
+    }
+
+    errno = EINVAL;
+    return -1;
 }
 
-static int
-_modbus_rtu_select(modbus_t *ctx, fd_set *rset, struct timeval *tv, int length_to_read)
+int modbus_rtu_get_frame_gap(modbus_t *ctx)
 {
-    int s_rc;
-#if defined(_WIN32)
-    s_rc = win32_ser_select(
-        &((modbus_rtu_t *) ctx->backend_data)->w_ser, length_to_read, tv);
-    if (s_rc == 0) {
-        errno = ETIMEDOUT;
+    if (ctx == NULL) {
+        errno = EINVAL;
         return -1;
     }
 
-    if (s_rc < 0) {
-        return -1;
-    }
-#else
-    while ((s_rc = select(ctx->s + 1, rset, NULL, NULL, tv)) == -1) {
-        if (errno == EINTR) {
-            if (ctx->debug) {
-                fprintf(stderr, "A non blocked signal was caught\n");
-            }
-            /* Necessary after an error */
-            FD_ZERO(rset);
-            FD_SET(ctx->s, rset);
-        } else {
-            return -1;
-        }
+    if (ctx->backend->backend_type == _MODBUS_BACKEND_TYPE_RTU) {
+        modbus_rtu_t *ctx_rtu = ctx->backend_data;
+        return ctx_rtu->frame_gap;
     }
 
-    if (s_rc == 0) {
-        /* Timeout */
-        errno = ETIMEDOUT;
+    errno = EINVAL;
+    return -1;
+}
+
+/* Drains everything available on the line into a per-context buffer with a
+   single read() and frames from it, so the header, meta and data steps of a
+   frame received at once don't cost a select() and a read() each. Bytes read
+   ahead are discarded by modbus_flush(). Only used with the length framing. */
+int modbus_rtu_set_buffered_read(modbus_t *ctx, int enable)
+{
+    if (ctx == NULL) {
+        errno = EINVAL;
         return -1;
     }
+
+    if (ctx->backend->backend_type == _MODBUS_BACKEND_TYPE_RTU) {
+#if defined(_WIN32)
+        /* Reads are always buffered by win32_ser */
+        if (ctx->debug) {
+            fprintf(stderr, "This function isn't supported on your platform\n");
+        }
+        errno = ENOTSUP;
+        return -1;
+#else
+        modbus_rtu_t *ctx_rtu = ctx->backend_data;
+        ctx_rtu->buffered_read = enable ? TRUE : FALSE;
+        return 0;
 #endif
+    }
 
-    return s_rc;
+    errno = EINVAL;
+    return -1;
 }
 
-static void _modbus_rtu_free(modbus_t *ctx)
+int modbus_rtu_get_buffered_read(modbus_t *ctx)
 {
-    if (ctx->backend_data) {
-        free(((modbus_rtu_t *) ctx->backend_data)->device);
-        free(ctx->backend_data);
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
     }
 
-    free(ctx);
-}
-
-// clang-format off
+    if (ctx->backend->backend_type == _MODBUS_BACKEND_TYPE_RTU) {
+#if defined(_WIN32)
+        return TRUE;
+#else
+        modbus_rtu_t *ctx_rtu = ctx->backend_data;
+        return ctx_rtu->buffered_read;
+#endif
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+int modbus_rtu_get_stats(modbus_t *ctx, modbus_rtu_stats_t *stats)
+{
+    modbus_rtu_t *ctx_rtu;
+
+    if (ctx == NULL || stats == NULL || ctx->backend->backend_type != _MODBUS_BACKEND_TYPE_RTU) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ctx_rtu = ctx->backend_data;
+    memset(stats, 0, sizeof(modbus_rtu_stats_t));
+    stats->nb_turnarounds = ctx_rtu->nb_turnarounds;
+    if (ctx_rtu->nb_turnarounds > 0) {
+        stats->turnaround_min = (int) ctx_rtu->turnaround_min;
+        stats->turnaround_max = (int) ctx_rtu->turnaround_max;
+        stats->turnaround_mean = (int) (ctx_rtu->turnaround_sum / ctx_rtu->nb_turnarounds);
+        stats->turnaround_jitter = (int) (ctx_rtu->turnaround_max - ctx_rtu->turnaround_min);
+    }
+#if !defined(_WIN32)
+    if (ctx_rtu->bus_active) {
+        int64_t elapsed = (int64_t) (ctx_rtu->last_frame_end.tv_sec - ctx_rtu->bus_start.tv_sec) *
+                              1000000 +
+                          (ctx_rtu->last_frame_end.tv_nsec - ctx_rtu->bus_start.tv_nsec) / 1000;
+
+        stats->bus_busy = ctx_rtu->bus_busy;
+        stats->bus_elapsed = elapsed > 0 ? elapsed : 0;
+        if (elapsed > 0) {
+            stats->bus_utilization = (double) ctx_rtu->bus_busy / elapsed;
+        }
+    }
+#endif
+
+    return 0;
+}
+
+int modbus_rtu_reset_stats(modbus_t *ctx)
+{
+    modbus_rtu_t *ctx_rtu;
+
+    if (ctx == NULL || ctx->backend->backend_type != _MODBUS_BACKEND_TYPE_RTU) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ctx_rtu = ctx->backend_data;
+    ctx_rtu->nb_turnarounds = 0;
+    ctx_rtu->turnaround_min = 0;
+    ctx_rtu->turnaround_max = 0;
+    ctx_rtu->turnaround_sum = 0;
+#if !defined(_WIN32)
+    ctx_rtu->bus_active = FALSE;
+    ctx_rtu->bus_busy = 0;
+#endif
+
+    return 0;
+}
+
+/* Selects how the end of a received frame is detected: from the length
+   computed from the function code (default) or from the inter-frame silence
+   (t3.5), which recovers from line noise or unknown function codes without
+   waiting for the byte timeout. */
+int modbus_rtu_set_frame_detection(modbus_t *ctx, int mode)
+{
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (ctx->backend->backend_type == _MODBUS_BACKEND_TYPE_RTU &&
+        (mode == MODBUS_RTU_FRAME_LENGTH || mode == MODBUS_RTU_FRAME_SILENCE)) {
+        modbus_rtu_t *ctx_rtu = ctx->backend_data;
+        ctx_rtu->frame_detection = mode;
+        return 0;
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+int modbus_rtu_get_frame_detection(modbus_t *ctx)
+{
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (ctx->backend->backend_type == _MODBUS_BACKEND_TYPE_RTU) {
+        modbus_rtu_t *ctx_rtu = ctx->backend_data;
+        return ctx_rtu->frame_detection;
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+/* Overrides the silence ending a frame, useful with USB adapters which
+   deliver bytes by packets. 0 restores t3.5 derived from the baud rate. */
+int modbus_rtu_set_frame_silence(modbus_t *ctx, int us)
+{
+    if (ctx == NULL || us < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (ctx->backend->backend_type == _MODBUS_BACKEND_TYPE_RTU) {
+        modbus_rtu_t *ctx_rtu = ctx->backend_data;
+        ctx_rtu->frame_silence = us;
+        return 0;
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+int modbus_rtu_get_frame_silence(modbus_t *ctx)
+{
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (ctx->backend->backend_type == _MODBUS_BACKEND_TYPE_RTU) {
+        return _modbus_rtu_silence_time((modbus_rtu_t *) ctx->backend_data);
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+static int _modbus_rtu_slave_arg(modbus_t *ctx, int slave)
+{
+    int max_slave;
+
+    if (ctx == NULL || ctx->backend->backend_type != _MODBUS_BACKEND_TYPE_RTU) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    max_slave = (ctx->quirks & MODBUS_QUIRK_MAX_SLAVE) ? 255 : 247;
+    if (slave < 1 || slave > max_slave) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Adds a slave address answered by the server in addition to the one defined
+   with modbus_set_slave(). Combined with a router (modbus_router_reply()), a
+   single serial port can simulate a whole RS-485 segment. */
+int modbus_rtu_add_slave(modbus_t *ctx, int slave)
+{
+    modbus_rtu_t *ctx_rtu;
+
+    if (_modbus_rtu_slave_arg(ctx, slave) == -1) {
+        return -1;
+    }
+
+    ctx_rtu = (modbus_rtu_t *) ctx->backend_data;
+    ctx_rtu->slaves[slave >> 3] |= (1 << (slave & 7));
+    return 0;
+}
+
+int modbus_rtu_remove_slave(modbus_t *ctx, int slave)
+{
+    modbus_rtu_t *ctx_rtu;
+
+    if (_modbus_rtu_slave_arg(ctx, slave) == -1) {
+        return -1;
+    }
+
+    ctx_rtu = (modbus_rtu_t *) ctx->backend_data;
+    ctx_rtu->slaves[slave >> 3] &= ~(1 << (slave & 7));
+    return 0;
+}
+
+int modbus_rtu_has_slave(modbus_t *ctx, int slave)
+{
+    modbus_rtu_t *ctx_rtu;
+
+    if (_modbus_rtu_slave_arg(ctx, slave) == -1) {
+        return -1;
+    }
+
+    ctx_rtu = (modbus_rtu_t *) ctx->backend_data;
+    return (ctx_rtu->slaves[slave >> 3] >> (slave & 7)) & 1;
+}
+
+#if !defined(_WIN32)
+/* State of a bus driven by modbus_rtu_scan() */
+typedef struct _modbus_rtu_scan_state {
+    /* Index of the current item, nb_items when the list is done */
+    int item;
+    /* Slave of the context, restored at the end */
+    int slave;
+    /* Request sent, waiting for the response */
+    int pending;
+    uint8_t req[_MIN_REQ_LENGTH];
+    uint8_t rsp[MODBUS_RTU_MAX_ADU_LENGTH];
+    int rsp_length;
+    int length_to_read;
+    struct timespec deadline;
+} modbus_rtu_scan_state_t;
+
+static void _modbus_rtu_scan_next(modbus_rtu_scan_list_t *list,
+                                  modbus_rtu_scan_state_t *state,
+                                  int rc,
+                                  int error)
+{
+    list->items[state->item].rc = rc;
+    list->items[state->item].error = rc == -1 ? error : 0;
+    state->item++;
+    state->pending = FALSE;
+}
+
+/* Sends the request of the current item */
+static void _modbus_rtu_scan_send(modbus_rtu_scan_list_t *list,
+                                  modbus_rtu_scan_state_t *state)
+{
+    modbus_t *ctx = list->ctx;
+    modbus_rtu_scan_item_t *item = &list->items[state->item];
+    int req_length;
+    ssize_t rc;
+
+    ctx->slave = item->slave;
+    req_length = ctx->backend->build_request_basis(
+        ctx, item->function, item->addr, item->nb, state->req);
+    req_length = ctx->backend->send_msg_pre(state->req, req_length);
+
+    if (ctx->debug) {
+        int i;
+        for (i = 0; i < req_length; i++)
+            printf("[%.2X]", state->req[i]);
+        printf("\n");
+    }
+
+    rc = ctx->backend->send(ctx, state->req, req_length);
+    if (rc != req_length) {
+        _modbus_rtu_scan_next(list, state, -1, rc == -1 ? errno : EMBBADDATA);
+        return;
+    }
+
+    /* Slave, function, CRC and the values */
+    if (item->function == MODBUS_FC_READ_COILS ||
+        item->function == MODBUS_FC_READ_DISCRETE_INPUTS) {
+        state->length_to_read = 5 + (item->nb / 8) + ((item->nb % 8) ? 1 : 0);
+    } else {
+        state->length_to_read = 5 + 2 * item->nb;
+    }
+    state->rsp_length = 0;
+    state->pending = TRUE;
+    clock_gettime(CLOCK_MONOTONIC, &state->deadline);
+    _modbus_rtu_add_us(&state->deadline,
+                       (int64_t) ctx->response_timeout.tv_sec * 1000000 +
+                           ctx->response_timeout.tv_usec);
+}
+
+/* Decodes the response of the current item once complete */
+static void _modbus_rtu_scan_response(modbus_rtu_scan_list_t *list,
+                                      modbus_rtu_scan_state_t *state)
+{
+    modbus_t *ctx = list->ctx;
+    modbus_rtu_scan_item_t *item = &list->items[state->item];
+    int rc;
+    int i;
+
+    rc = ctx->backend->check_integrity(ctx, state->rsp, state->rsp_length);
+    if (rc == -1) {
+        _modbus_rtu_scan_next(list, state, -1, errno);
+        return;
+    }
+
+    rc = _modbus_check_confirmation(ctx, state->req, state->rsp, state->rsp_length);
+    if (rc == -1) {
+        _modbus_rtu_scan_next(list, state, -1, errno);
+        return;
+    }
+
+    if (item->function == MODBUS_FC_READ_COILS ||
+        item->function == MODBUS_FC_READ_DISCRETE_INPUTS) {
+        uint8_t *dest = item->dest;
+
+        for (i = 0; i < item->nb; i++) {
+            dest[i] = (state->rsp[3 + (i >> 3)] >> (i & 7)) & 1;
+        }
+    } else {
+        uint16_t *dest = item->dest;
+
+        for (i = 0; i < item->nb; i++) {
+            dest[i] = (state->rsp[3 + (i << 1)] << 8) | state->rsp[4 + (i << 1)];
+        }
+    }
+
+    _modbus_rtu_scan_next(list, state, item->nb, 0);
+}
+
+/* Reads what the line provides for the pending response */
+static void _modbus_rtu_scan_recv(modbus_rtu_scan_list_t *list,
+                                  modbus_rtu_scan_state_t *state)
+{
+    modbus_t *ctx = list->ctx;
+    modbus_rtu_t *ctx_rtu = ctx->backend_data;
+    ssize_t rc;
+
+    do {
+        rc = ctx->backend->recv(
+            ctx, state->rsp + state->rsp_length, state->length_to_read - state->rsp_length);
+        if (rc <= 0) {
+            if (rc == -1 && (errno == EAGAIN || errno == EINTR)) {
+                return;
+            }
+            _modbus_rtu_scan_next(list, state, -1, rc == 0 ? ECONNRESET : errno);
+            _modbus_rtu_flush(ctx);
+            return;
+        }
+
+        if (ctx->debug) {
+            int i;
+            for (i = 0; i < rc; i++)
+                printf("<%.2X>", state->rsp[state->rsp_length + i]);
+        }
+
+        state->rsp_length += rc;
+        if (state->rsp_length >= 2 && (state->rsp[1] & 0x80)) {
+            /* Exception response */
+            state->length_to_read = _MODBUS_EXCEPTION_RSP_LENGTH;
+        }
+        /* Bytes read ahead in buffered mode are not seen by select() */
+    } while (state->rsp_length < state->length_to_read &&
+             ctx_rtu->rbuf_start < ctx_rtu->rbuf_end);
+
+    if (state->rsp_length < state->length_to_read) {
+        if (ctx->byte_timeout.tv_sec > 0 || ctx->byte_timeout.tv_usec > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &state->deadline);
+            _modbus_rtu_add_us(&state->deadline,
+                               (int64_t) ctx->byte_timeout.tv_sec * 1000000 +
+                                   ctx->byte_timeout.tv_usec);
+        }
+        return;
+    }
+
+    if (ctx->debug) {
+        printf("\n");
+    }
+    _modbus_rtu_scan_response(list, state);
+}
+
+static int _modbus_rtu_scan_check(modbus_rtu_scan_list_t *list)
+{
+    int i;
+    int max_slave;
+
+    if (list->ctx == NULL || list->ctx->backend->backend_type != _MODBUS_BACKEND_TYPE_RTU ||
+        list->ctx->s < 0 || list->ctx->s >= FD_SETSIZE ||
+        (list->nb_items > 0 && list->items == NULL) || list->nb_items < 0) {
+        return -1;
+    }
+
+    max_slave = (list->ctx->quirks & MODBUS_QUIRK_MAX_SLAVE) ? 255 : 247;
+
+    for (i = 0; i < list->nb_items; i++) {
+        modbus_rtu_scan_item_t *item = &list->items[i];
+        int max_nb;
+
+        switch (item->function) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+            max_nb = MODBUS_MAX_READ_BITS;
+            break;
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+            max_nb = MODBUS_MAX_READ_REGISTERS;
+            break;
+        default:
+            return -1;
+        }
+
+        /* No response to wait from the broadcast address */
+        if (item->slave < 1 || item->slave > max_slave || item->nb < 1 || item->nb > max_nb ||
+            item->dest == NULL) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+#endif
+
+/* Runs the scan lists of several RTU contexts (one per serial port)
+   concurrently from a single select() loop: each bus sends its next request
+   as soon as the previous transaction is done (and t3.5 elapsed when the
+   frame gap is enforced) while the other buses are waiting for their
+   responses.
+
+   The function returns when every list has been scanned once. The result
+   of each item is stored in its rc field (nb or -1 with the error in the
+   error field). It shall return the number of successful items or -1 with
+   errno set to EINVAL if a list is invalid. */
+int modbus_rtu_scan(modbus_rtu_scan_list_t *lists, int nb_lists)
+{
+#if defined(_WIN32)
+    (void) lists;
+    (void) nb_lists;
+    errno = ENOTSUP;
+    return -1;
+#else
+    modbus_rtu_scan_state_t *states;
+    int nb_ok = 0;
+    int i;
+
+    if (lists == NULL || nb_lists < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < nb_lists; i++) {
+        if (_modbus_rtu_scan_check(&lists[i]) == -1) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    states = calloc(nb_lists, sizeof(modbus_rtu_scan_state_t));
+    if (states == NULL) {
+        return -1;
+    }
+    for (i = 0; i < nb_lists; i++) {
+        states[i].slave = lists[i].ctx->slave;
+    }
+
+    for (;;) {
+        struct timespec now;
+        struct timespec next = {0, 0};
+        int has_next = FALSE;
+        int max_fd = -1;
+        fd_set rset;
+        struct timeval tv;
+        int rc;
+
+        FD_ZERO(&rset);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        for (i = 0; i < nb_lists; i++) {
+            modbus_rtu_scan_list_t *list = &lists[i];
+            modbus_rtu_scan_state_t *state = &states[i];
+            modbus_rtu_t *ctx_rtu = list->ctx->backend_data;
+            struct timespec deadline;
+
+            if (state->pending &&
+                !_modbus_rtu_timespec_before(&now, &state->deadline)) {
+                if (list->ctx->debug) {
+                    fprintf(stderr, "ERROR Response timeout on the scanned bus\n");
+                }
+                _modbus_rtu_scan_next(list, state, -1, ETIMEDOUT);
+                _modbus_rtu_flush(list->ctx);
+            }
+
+            if (state->item >= list->nb_items) {
+                continue;
+            }
+
+            if (!state->pending) {
+                /* Sent without blocking once the gap elapsed */
+                deadline = ctx_rtu->last_frame_end;
+                _modbus_rtu_add_us(&deadline, _modbus_rtu_silence_time(ctx_rtu));
+                if (ctx_rtu->frame_gap && ctx_rtu->bus_active &&
+                    _modbus_rtu_timespec_before(&now, &deadline)) {
+                    if (!has_next || _modbus_rtu_timespec_before(&deadline, &next)) {
+                        next = deadline;
+                        has_next = TRUE;
+                    }
+                    continue;
+                }
+
+                _modbus_rtu_scan_send(list, state);
+                if (!state->pending) {
+                    /* Send error, the next item is tried at once */
+                    next = now;
+                    has_next = TRUE;
+                    continue;
+                }
+            }
+
+            FD_SET(list->ctx->s, &rset);
+            if (list->ctx->s > max_fd) {
+                max_fd = list->ctx->s;
+            }
+            if (!has_next || _modbus_rtu_timespec_before(&state->deadline, &next)) {
+                next = state->deadline;
+                has_next = TRUE;
+            }
+        }
+
+        if (!has_next) {
+            /* Every list is done */
+            break;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (_modbus_rtu_timespec_before(&now, &next)) {
+            int64_t us = (int64_t) (next.tv_sec - now.tv_sec) * 1000000 +
+                         (next.tv_nsec - now.tv_nsec + 999) / 1000;
+            tv.tv_sec = us / 1000000;
+            tv.tv_usec = us % 1000000;
+        } else {
+            tv.tv_sec = 0;
+            tv.tv_usec = 0;
+        }
+
+        rc = select(max_fd + 1, &rset, NULL, NULL, &tv);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            for (i = 0; i < nb_lists; i++) {
+                lists[i].ctx->slave = states[i].slave;
+            }
+            free(states);
+            return -1;
+        }
+
+        for (i = 0; i < nb_lists && rc > 0; i++) {
+            if (states[i].pending && FD_ISSET(lists[i].ctx->s, &rset)) {
+                _modbus_rtu_scan_recv(&lists[i], &states[i]);
+            }
+        }
+    }
+
+    for (i = 0; i < nb_lists; i++) {
+        int j;
+
+        lists[i].ctx->slave = states[i].slave;
+        for (j = 0; j < lists[i].nb_items; j++) {
+            if (lists[i].items[j].rc != -1) {
+                nb_ok++;
+            }
+        }
+    }
+
+    free(states);
+    return nb_ok;
+#endif
+}
+
+#if !defined(_WIN32)
+/* Time of the realtime clock in microseconds */
+static int64_t _modbus_rtu_realtime_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+#endif
+
+#if !defined(_WIN32)
+/* Tells whether a valid frame is the response to the pending request: same
+   slave and function, the length expected for the request (5 bytes for an
+   exception) and not a copy of the request, as a master retrying after a
+   timeout sends the same frame again. FC05 and FC06 responses echo the
+   request, the copy is a response when it comes within the response timeout
+   of the context. */
+static int _modbus_rtu_monitor_is_response(modbus_t *ctx,
+                                           uint8_t *req,
+                                           int req_length,
+                                           int64_t req_end,
+                                           const uint8_t *frame,
+                                           int length,
+                                           int64_t frame_start)
+{
+    int expected;
+
+    if (req_length == 0 || frame[0] != req[0] || (frame[1] & 0x7F) != req[1]) {
+        return FALSE;
+    }
+
+    if (frame[1] & 0x80) {
+        return length == 5;
+    }
+
+    expected = _modbus_response_length(ctx, req);
+    if (expected != -1 && length != expected) {
+        return FALSE;
+    }
+
+    if (length == req_length && memcmp(frame, req, length) == 0) {
+        int64_t timeout = (int64_t) ctx->response_timeout.tv_sec * 1000000 +
+                          ctx->response_timeout.tv_usec;
+
+        return (req[1] == MODBUS_FC_WRITE_SINGLE_COIL ||
+                req[1] == MODBUS_FC_WRITE_SINGLE_REGISTER) &&
+               frame_start - req_end <= timeout;
+    }
+
+    return TRUE;
+}
+#endif
+
+/* Listens to the bus without ever sending: frames are delimited by the t3.5
+   silence (see modbus_rtu_set_frame_silence()), their CRC is checked and each
+   valid response is paired with the request sent just before to the same
+   slave. A record is passed to the callback for every frame, and an IDLE one
+   each time the bus stays silent for the response timeout.
+
+   The function returns the first non-zero value returned by the callback or
+   -1 on error (the timeouts aren't errors, the bus can be idle). */
+int modbus_rtu_monitor(modbus_t *ctx, modbus_rtu_monitor_t callback, void *user_data)
+{
+#if defined(_WIN32)
+    (void) callback;
+    (void) user_data;
+    if (ctx != NULL && ctx->debug) {
+        fprintf(stderr, "This function isn't supported on your platform\n");
+    }
+    errno = ENOTSUP;
+    return -1;
+#else
+    modbus_rtu_t *ctx_rtu;
+    uint8_t frame[MODBUS_RTU_MAX_ADU_LENGTH];
+    int length = 0;
+    int overflow = FALSE;
+    int64_t frame_start = 0;
+    int64_t frame_end = 0;
+    /* Last valid request waiting for its response */
+    uint8_t req[MODBUS_RTU_MAX_ADU_LENGTH];
+    int req_length = 0;
+    int64_t req_end = 0;
+
+    if (ctx == NULL || callback == NULL ||
+        ctx->backend->backend_type != _MODBUS_BACKEND_TYPE_RTU || ctx->s < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    ctx_rtu = ctx->backend_data;
+
+    for (;;) {
+        fd_set rset;
+        struct timeval tv;
+        int silence = _modbus_rtu_silence_time(ctx_rtu);
+        ssize_t rc;
+
+        FD_ZERO(&rset);
+        FD_SET(ctx->s, &rset);
+        if (length > 0) {
+            tv.tv_sec = silence / 1000000;
+            tv.tv_usec = silence % 1000000;
+        } else {
+            /* Bounded wait on an idle bus, the callback may stop the monitor */
+            tv = ctx->response_timeout;
+        }
+
+        rc = select(ctx->s + 1, &rset, NULL, NULL, &tv);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        if (rc > 0) {
+            uint8_t discard[MODBUS_RTU_MAX_ADU_LENGTH];
+            struct timespec now;
+
+            if (overflow) {
+                rc = read(ctx->s, discard, sizeof(discard));
+            } else {
+                rc = read(ctx->s, frame + length, sizeof(frame) - length);
+            }
+            if (rc == 0) {
+                errno = ECONNRESET;
+                return -1;
+            }
+            if (rc == -1) {
+                if (errno == EAGAIN || errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            _modbus_rtu_add_bus_activity(ctx_rtu, &now, rc);
+
+            frame_end = _modbus_rtu_realtime_us();
+            if (length == 0 && !overflow) {
+                /* The first characters were on the wire before the read */
+                frame_start = frame_end - _modbus_rtu_wire_time(ctx_rtu, rc);
+            }
+            if (!overflow) {
+                length += rc;
+                if (length == (int) sizeof(frame)) {
+                    /* Longer than any RTU frame, the rest is dropped */
+                    overflow = TRUE;
+                }
+            }
+            continue;
+        }
+
+        if (length == 0) {
+            modbus_rtu_record_t record;
+
+            memset(&record, 0, sizeof(record));
+            record.timestamp = _modbus_rtu_realtime_us();
+            record.type = MODBUS_RTU_RECORD_IDLE;
+            record.slave = -1;
+            record.function = -1;
+            record.response_time = -1;
+
+            rc = callback(ctx, &record, user_data);
+            if (rc != 0) {
+                return rc;
+            }
+            continue;
+        }
+
+        /* Silence, end of frame */
+        {
+            modbus_rtu_record_t record;
+
+            record.timestamp = frame_start;
+            record.duration = (int) (frame_end - frame_start);
+            record.data = frame;
+            record.length = length;
+            record.slave = frame[0];
+            record.function = length > 1 ? frame[1] : -1;
+            record.crc_ok = !overflow && length >= 4 &&
+                            _modbus_crc16(frame, length - 2) ==
+                                ((frame[length - 1] << 8) | frame[length - 2]);
+            record.response_time = -1;
+
+            if (!record.crc_ok) {
+                record.type = MODBUS_RTU_RECORD_INVALID;
+            } else if (_modbus_rtu_monitor_is_response(
+                           ctx, req, req_length, req_end, frame, length, frame_start)) {
+                record.type = MODBUS_RTU_RECORD_RESPONSE;
+                record.response_time = frame_start - req_end;
+                req_length = 0;
+            } else {
+                record.type = MODBUS_RTU_RECORD_REQUEST;
+                /* No response to a broadcast request */
+                if (record.slave != MODBUS_BROADCAST_ADDRESS) {
+                    memcpy(req, frame, length);
+                    req_length = length;
+                } else {
+                    req_length = 0;
+                }
+                req_end = frame_end;
+            }
+
+            if (ctx->debug) {
+                int i;
+                printf("%s (%d bytes):",
+                       record.type == MODBUS_RTU_RECORD_REQUEST    ? "Request"
+                       : record.type == MODBUS_RTU_RECORD_RESPONSE ? "Response"
+                                                                   : "Invalid frame",
+                       length);
+                for (i = 0; i < length; i++)
+                    printf(" %.2X", frame[i]);
+                printf("\n");
+            }
+
+            length = 0;
+            overflow = FALSE;
+
+            rc = callback(ctx, &record, user_data);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+    }
+#endif
+}
+
+static void _modbus_rtu_close(modbus_t *ctx)
+{
+    /* Restore line settings and close file descriptor in RTU mode */
+    modbus_rtu_t *ctx_rtu = ctx->backend_data;
+
+#if defined(_WIN32)
+    /* Revert settings */
+    if (!SetCommState(ctx_rtu->w_ser.fd, &ctx_rtu->old_dcb) && ctx->debug) {
+        fprintf(stderr,
+                "ERROR Couldn't revert to configuration (LastError %d)\n",
+                (int) GetLastError());
+    }
+
+    if (!CloseHandle(ctx_rtu->w_ser.fd) && ctx->debug) {
+        fprintf(stderr,
+                "ERROR Error while closing handle (LastError %d)\n",
+                (int) GetLastError());
+    }
+#else
+    if (ctx->s >= 0) {
+        tcsetattr(ctx->s, TCSANOW, &ctx_rtu->old_tios);
+        close(ctx->s);
+        ctx->s = -1;
+    }
+#endif
+}
+
+static int _modbus_rtu_flush(modbus_t *ctx)
+{
+#if defined(_WIN32)
+    modbus_rtu_t *ctx_rtu = ctx->backend_data;
+    ctx_rtu->w_ser.n_bytes = 0;
+    return (PurgeComm(ctx_rtu->w_ser.fd, PURGE_RXCLEAR) == FALSE);
+#else
+    modbus_rtu_t *ctx_rtu = ctx->backend_data;
+    ctx_rtu->rbuf_start = 0;
+    ctx_rtu->rbuf_end = 0;
+    return tcflush(ctx->s, TCIOFLUSH);
+#endif
+}
+
+static int
+_modbus_rtu_select(modbus_t *ctx, fd_set *rset, struct timeval *tv, int length_to_read)
+{
+    int s_rc;
+#if defined(_WIN32)
+    s_rc = win32_ser_select(
+        &((modbus_rtu_t *) ctx->backend_data)->w_ser, length_to_read, tv);
+    if (s_rc == 0) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    if (s_rc < 0) {
+        return -1;
+    }
+#else
+    modbus_rtu_t *ctx_rtu = ctx->backend_data;
+
+    if (ctx_rtu->rbuf_start < ctx_rtu->rbuf_end) {
+        /* Already read */
+        return 1;
+    }
+
+    while ((s_rc = select(ctx->s + 1, rset, NULL, NULL, tv)) == -1) {
+        if (errno == EINTR) {
+            if (ctx->debug) {
+                fprintf(stderr, "A non blocked signal was caught\n");
+            }
+            /* Necessary after an error */
+            FD_ZERO(rset);
+            FD_SET(ctx->s, rset);
+        } else {
+            return -1;
+        }
+    }
+
+    if (s_rc == 0) {
+        /* Timeout */
+        errno = ETIMEDOUT;
+        return -1;
+    }
+#endif
+
+    return s_rc;
+}
+
+/* Returns the silence ending a frame when frames are delimited by silence, 0
+   otherwise */
+static int _modbus_rtu_frame_silence(modbus_t *ctx)
+{
+    modbus_rtu_t *ctx_rtu = ctx->backend_data;
+
+    if (ctx_rtu->frame_detection != MODBUS_RTU_FRAME_SILENCE) {
+        return 0;
+    }
+
+    return _modbus_rtu_silence_time(ctx_rtu);
+}
+
+static void _modbus_rtu_free(modbus_t *ctx)
+{
+    if (ctx->backend_data) {
+        free(((modbus_rtu_t *) ctx->backend_data)->device);
+        free(ctx->backend_data);
+    }
+
+    free(ctx);
+}
+
+// clang-format off
 const modbus_backend_t _modbus_rtu_backend = {
     _MODBUS_BACKEND_TYPE_RTU,
     _MODBUS_RTU_HEADER_LENGTH,
@@ -1197,7 +2388,8 @@ const modbus_backend_t _modbus_rtu_backend = {
     _modbus_rtu_close,
     _modbus_rtu_flush,
     _modbus_rtu_select,
-    _modbus_rtu_free
+    _modbus_rtu_free,
+    _modbus_rtu_frame_silence
 };
 
 // clang-format on
@@ -1271,18 +2463,36 @@ modbus_new_rtu(const char *device, int baud, char parity, int data_bit, int stop
     /* The RTS use has been set by default */
     ctx_rtu->rts = MODBUS_RTU_RTS_NONE;
 
-    /* Calculate estimated time in micro second to send one byte */
-    ctx_rtu->onebyte_time =
-        1000000 * (1 + data_bit + (parity == 'N' ? 0 : 1) + stop_bit) / baud;
-
     /* The internal function is used by default to set RTS */
     ctx_rtu->set_rts = _modbus_rtu_ioctl_rts;
 
-    /* The delay before and after transmission when toggling the RTS pin */
-    ctx_rtu->rts_delay = ctx_rtu->onebyte_time;
+    ctx_rtu->onebyte_time = 0;
+    ctx_rtu->rts_delay = 0;
 #endif
+    _modbus_rtu_update_timings(ctx_rtu);
 
     ctx_rtu->confirmation_to_ignore = FALSE;
+    memset(ctx_rtu->slaves, 0, sizeof(ctx_rtu->slaves));
+
+    ctx_rtu->frame_detection = MODBUS_RTU_FRAME_LENGTH;
+    ctx_rtu->frame_silence = 0;
+
+    ctx_rtu->drain_mode = MODBUS_RTU_DRAIN_SLEEP;
+    ctx_rtu->nb_turnarounds = 0;
+    ctx_rtu->turnaround_min = 0;
+    ctx_rtu->turnaround_max = 0;
+    ctx_rtu->turnaround_sum = 0;
+
+    ctx_rtu->frame_gap = FALSE;
+#if !defined(_WIN32)
+    memset(&ctx_rtu->last_frame_end, 0, sizeof(struct timespec));
+    ctx_rtu->bus_active = FALSE;
+    ctx_rtu->bus_busy = 0;
+
+    ctx_rtu->buffered_read = FALSE;
+    ctx_rtu->rbuf_start = 0;
+    ctx_rtu->rbuf_end = 0;
+#endif
 
     return ctx;
 }
@@ -38,6 +38,108 @@ MODBUS_API int modbus_rtu_set_custom_rts(modbus_t *ctx,
 MODBUS_API int modbus_rtu_set_rts_delay(modbus_t *ctx, int us);
 MODBUS_API int modbus_rtu_get_rts_delay(modbus_t *ctx);
 
+/* How the end of a transmission is awaited before releasing RTS */
+#define MODBUS_RTU_DRAIN_SLEEP   0
+#define MODBUS_RTU_DRAIN_TCDRAIN 1
+#define MODBUS_RTU_DRAIN_LSR     2
+
+MODBUS_API int modbus_rtu_set_drain_mode(modbus_t *ctx, int mode);
+MODBUS_API int modbus_rtu_get_drain_mode(modbus_t *ctx);
+
+typedef struct _modbus_rtu_stats {
+    /* Number of transmissions with a measured turnaround */
+    unsigned int nb_turnarounds;
+    /* Time in microseconds between the end of the frame on the wire (estimated
+       from the baud rate) and the release of the line */
+    int turnaround_min;
+    int turnaround_max;
+    int turnaround_mean;
+    /* Peak to peak variation (max - min) */
+    int turnaround_jitter;
+    /* Time frames spent on the wire (sent and received) and time elapsed
+       between the first and the last frame, in microseconds */
+    uint64_t bus_busy;
+    uint64_t bus_elapsed;
+    /* bus_busy / bus_elapsed, from 0 to 1 */
+    double bus_utilization;
+} modbus_rtu_stats_t;
+
+MODBUS_API int modbus_rtu_set_frame_gap(modbus_t *ctx, int enable);
+MODBUS_API int modbus_rtu_get_frame_gap(modbus_t *ctx);
+
+MODBUS_API int modbus_rtu_set_buffered_read(modbus_t *ctx, int enable);
+MODBUS_API int modbus_rtu_get_buffered_read(modbus_t *ctx);
+
+/* Read request of a scan list (function 1 to 4), dest holds nb uint8_t
+   for the bits or nb uint16_t for the registers */
+typedef struct _modbus_rtu_scan_item {
+    int slave;
+    int function;
+    int addr;
+    int nb;
+    void *dest;
+    /* Set by modbus_rtu_scan(): nb or -1 and the errno value in error */
+    int rc;
+    int error;
+} modbus_rtu_scan_item_t;
+
+typedef struct _modbus_rtu_scan_list {
+    /* Connected RTU context of the serial port */
+    modbus_t *ctx;
+    modbus_rtu_scan_item_t *items;
+    int nb_items;
+} modbus_rtu_scan_list_t;
+
+MODBUS_API int modbus_rtu_scan(modbus_rtu_scan_list_t *lists, int nb_lists);
+
+#define MODBUS_RTU_RECORD_REQUEST  0
+#define MODBUS_RTU_RECORD_RESPONSE 1
+#define MODBUS_RTU_RECORD_INVALID  2
+#define MODBUS_RTU_RECORD_IDLE     3
+
+/* Frame seen on the bus by modbus_rtu_monitor() */
+typedef struct _modbus_rtu_record {
+    /* Start of the frame (realtime clock, microseconds since the Epoch) and
+       its duration on the wire in microseconds */
+    int64_t timestamp;
+    int duration;
+    /* MODBUS_RTU_RECORD_REQUEST, RESPONSE or INVALID (bad CRC or noise), or
+       IDLE without any frame when the bus stayed silent for the response
+       timeout, so that the callback can stop the monitor */
+    int type;
+    int slave;
+    int function;
+    int crc_ok;
+    /* For a response, time from the end of the request to the start of the
+       response in microseconds, -1 otherwise */
+    int64_t response_time;
+    /* Frame with its CRC, only valid during the callback */
+    const uint8_t *data;
+    int length;
+} modbus_rtu_record_t;
+
+typedef int (*modbus_rtu_monitor_t)(modbus_t *ctx,
+                                    const modbus_rtu_record_t *record,
+                                    void *user_data);
+
+MODBUS_API int
+modbus_rtu_monitor(modbus_t *ctx, modbus_rtu_monitor_t callback, void *user_data);
+
+MODBUS_API int modbus_rtu_get_stats(modbus_t *ctx, modbus_rtu_stats_t *stats);
+MODBUS_API int modbus_rtu_reset_stats(modbus_t *ctx);
+
+#define MODBUS_RTU_FRAME_LENGTH  0
+#define MODBUS_RTU_FRAME_SILENCE 1
+
+MODBUS_API int modbus_rtu_set_frame_detection(modbus_t *ctx, int mode);
+MODBUS_API int modbus_rtu_get_frame_detection(modbus_t *ctx);
+MODBUS_API int modbus_rtu_set_frame_silence(modbus_t *ctx, int us);
+MODBUS_API int modbus_rtu_get_frame_silence(modbus_t *ctx);
+
+MODBUS_API int modbus_rtu_add_slave(modbus_t *ctx, int slave);
+MODBUS_API int modbus_rtu_remove_slave(modbus_t *ctx, int slave);
+MODBUS_API int modbus_rtu_has_slave(modbus_t *ctx, int slave);
+
 MODBUS_END_DECLS
 
 #endif /* MODBUS_RTU_H */
@@ -13,6 +13,13 @@
 
 #define _MODBUS_TCP_CHECKSUM_LENGTH 0
 
+/* RTU over TCP (no MBAP header, CRC) */
+#define _MODBUS_RTU_TCP_HEADER_LENGTH     1
+#define _MODBUS_RTU_TCP_PRESET_REQ_LENGTH 6
+#define _MODBUS_RTU_TCP_PRESET_RSP_LENGTH 2
+
+#define _MODBUS_RTU_TCP_CHECKSUM_LENGTH 2
+
 /* In both structures, the transaction ID must be placed on first position
    to have a quick access not dependent of the TCP backend */
 typedef struct _modbus_tcp {
@@ -38,4 +45,52 @@ typedef struct _modbus_tcp_pi {
     char *service;
 } modbus_tcp_pi_t;
 
+typedef struct _modbus_unix {
+    /* Transaction ID */
+    uint16_t t_id;
+    /* Path of the socket */
+    char *path;
+} modbus_unix_t;
+
+typedef struct _modbus_udp {
+    /* Transaction ID */
+    uint16_t t_id;
+    /* UDP port */
+    int port;
+    /* IP address */
+    char ip[16];
+    /* Connected to a server (requests sent), otherwise bound (responses) */
+    int client;
+    /* Number of times a request is sent again on response timeout */
+    int retries;
+    int nb_retries;
+    /* Last request sent, the only one whose response is accepted */
+    uint8_t req[MODBUS_TCP_MAX_ADU_LENGTH];
+    int req_length;
+    int req_pending;
+    /* Datagram consumed by recv() */
+    uint8_t dgram[MODBUS_TCP_MAX_ADU_LENGTH];
+    int dgram_start;
+    int dgram_end;
+    /* A frame is being read from the datagram, it must not continue in the
+       next one */
+    int frame_pending;
+    /* Sender of the last indication */
+    struct sockaddr_storage peer;
+    socklen_t peer_length;
+} modbus_udp_t;
+
+typedef struct _modbus_loopback {
+    /* Transaction ID */
+    uint16_t t_id;
+    /* Context at the other end of the queues */
+    modbus_t *peer;
+    /* Data served by the server side, NULL on the client side */
+    modbus_mapping_t *mb_mapping;
+    /* Bytes sent by the peer and not received yet */
+    uint8_t queue[2 * MODBUS_TCP_MAX_ADU_LENGTH];
+    int queue_start;
+    int queue_end;
+} modbus_loopback_t;
+
 #endif /* MODBUS_TCP_PRIVATE_H */
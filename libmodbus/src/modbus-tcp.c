@@ -30,6 +30,7 @@
 #include <unistd.h>
 #endif
 #include <signal.h>
+#include <assert.h>
 #include <sys/types.h>
 
 #if defined(_WIN32)
@@ -57,6 +58,10 @@
 # include <netinet/tcp.h>
 # include <arpa/inet.h>
 # include <netdb.h>
+# include <sys/stat.h>
+#ifdef HAVE_SYS_UN_H
+# include <sys/un.h>
+#endif
 #endif
 
 #if !defined(MSG_NOSIGNAL)
@@ -821,6 +826,119 @@ _modbus_tcp_select(modbus_t *ctx, fd_set *rset, struct timeval *tv, int length_t
     return s_rc;
 }
 
+/* RTU over TCP: RTU frames (slave, PDU and CRC) without MBAP header sent
+   as is over the TCP connection, as tunneled by many serial device servers */
+static int _modbus_rtu_tcp_set_slave(modbus_t *ctx, int slave)
+{
+    int max_slave = (ctx->quirks & MODBUS_QUIRK_MAX_SLAVE) ? 255 : 247;
+
+    /* Broadcast address is 0 (MODBUS_BROADCAST_ADDRESS) */
+    if (slave >= 0 && slave <= max_slave) {
+        ctx->slave = slave;
+    } else {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int _modbus_rtu_tcp_build_request_basis(
+    modbus_t *ctx, int function, int addr, int nb, uint8_t *req)
+{
+    assert(ctx->slave != -1);
+    req[0] = ctx->slave;
+    req[1] = function;
+    req[2] = addr >> 8;
+    req[3] = addr & 0x00ff;
+    req[4] = nb >> 8;
+    req[5] = nb & 0x00ff;
+
+    return _MODBUS_RTU_TCP_PRESET_REQ_LENGTH;
+}
+
+static int _modbus_rtu_tcp_build_response_basis(sft_t *sft, uint8_t *rsp)
+{
+    rsp[0] = sft->slave;
+    rsp[1] = sft->function;
+
+    return _MODBUS_RTU_TCP_PRESET_RSP_LENGTH;
+}
+
+static int _modbus_rtu_tcp_get_response_tid(const uint8_t *req)
+{
+    /* No TID */
+    return 0;
+}
+
+static int _modbus_rtu_tcp_send_msg_pre(uint8_t *req, int req_length)
+{
+    uint16_t crc = _modbus_crc16(req, req_length);
+
+    /* Low order byte of the CRC first as on the serial line */
+    req[req_length++] = crc & 0x00FF;
+    req[req_length++] = crc >> 8;
+
+    return req_length;
+}
+
+static int _modbus_rtu_tcp_check_integrity(modbus_t *ctx, uint8_t *msg, const int msg_length)
+{
+    uint16_t crc_calculated;
+    uint16_t crc_received;
+    int slave = msg[0];
+
+    crc_calculated = _modbus_crc16(msg, msg_length - 2);
+    crc_received = (msg[msg_length - 1] << 8) | msg[msg_length - 2];
+
+    if (crc_calculated != crc_received) {
+        if (ctx->debug) {
+            fprintf(stderr,
+                    "ERROR CRC received 0x%0X != CRC calculated 0x%0X\n",
+                    crc_received,
+                    crc_calculated);
+        }
+
+        if (ctx->error_recovery & MODBUS_ERROR_RECOVERY_PROTOCOL) {
+            _modbus_tcp_flush(ctx);
+        }
+        errno = EMBBADCRC;
+        return -1;
+    }
+
+    /* The device server may forward the whole serial bus traffic */
+    if (slave != ctx->slave && slave != MODBUS_BROADCAST_ADDRESS) {
+        if (ctx->debug) {
+            printf("Request for slave %d ignored (not %d)\n", slave, ctx->slave);
+        }
+        /* Following call to check_confirmation handles this error */
+        return 0;
+    }
+
+    return msg_length;
+}
+
+static int _modbus_rtu_tcp_pre_check_confirmation(modbus_t *ctx,
+                                                  const uint8_t *req,
+                                                  const uint8_t *rsp,
+                                                  int rsp_length)
+{
+    /* Check responding slave is the slave we requested (except for broadcast
+     * request) */
+    if (req[0] != rsp[0] && req[0] != MODBUS_BROADCAST_ADDRESS) {
+        if (ctx->debug) {
+            fprintf(stderr,
+                    "The responding slave %d isn't the requested slave %d\n",
+                    rsp[0],
+                    req[0]);
+        }
+        errno = EMBBADSLAVE;
+        return -1;
+    }
+
+    return 0;
+}
+
 static void _modbus_tcp_free(modbus_t *ctx)
 {
     if (ctx->backend_data) {
@@ -841,172 +959,1326 @@ static void _modbus_tcp_pi_free(modbus_t *ctx)
     free(ctx);
 }
 
-// clang-format off
-const modbus_backend_t _modbus_tcp_backend = {
-    _MODBUS_BACKEND_TYPE_TCP,
-    _MODBUS_TCP_HEADER_LENGTH,
-    _MODBUS_TCP_CHECKSUM_LENGTH,
-    MODBUS_TCP_MAX_ADU_LENGTH,
-    _modbus_set_slave,
-    _modbus_tcp_build_request_basis,
-    _modbus_tcp_build_response_basis,
-    _modbus_tcp_get_response_tid,
-    _modbus_tcp_send_msg_pre,
-    _modbus_tcp_send,
-    _modbus_tcp_receive,
-    _modbus_tcp_recv,
-    _modbus_tcp_check_integrity,
-    _modbus_tcp_pre_check_confirmation,
-    _modbus_tcp_connect,
-    _modbus_tcp_is_connected,
-    _modbus_tcp_close,
-    _modbus_tcp_flush,
-    _modbus_tcp_select,
-    _modbus_tcp_free
-};
+/* Modbus UDP: one MBAP frame per datagram. The client connects the socket
+   to the server, a server binds it and answers to the sender of the last
+   indication. */
+static int _modbus_udp_socket(modbus_t *ctx)
+{
+    int flags = SOCK_DGRAM;
 
-const modbus_backend_t _modbus_tcp_pi_backend = {
-    _MODBUS_BACKEND_TYPE_TCP,
-    _MODBUS_TCP_HEADER_LENGTH,
-    _MODBUS_TCP_CHECKSUM_LENGTH,
-    MODBUS_TCP_MAX_ADU_LENGTH,
-    _modbus_set_slave,
-    _modbus_tcp_build_request_basis,
-    _modbus_tcp_build_response_basis,
-    _modbus_tcp_get_response_tid,
-    _modbus_tcp_send_msg_pre,
-    _modbus_tcp_send,
-    _modbus_tcp_receive,
-    _modbus_tcp_recv,
-    _modbus_tcp_check_integrity,
-    _modbus_tcp_pre_check_confirmation,
-    _modbus_tcp_pi_connect,
-    _modbus_tcp_is_connected,
-    _modbus_tcp_close,
-    _modbus_tcp_flush,
-    _modbus_tcp_select,
-    _modbus_tcp_pi_free
-};
+#ifdef OS_WIN32
+    if (_modbus_tcp_init_win32() == -1) {
+        return -1;
+    }
+#endif
 
-// clang-format on
+#ifdef SOCK_CLOEXEC
+    flags |= SOCK_CLOEXEC;
+#endif
 
-modbus_t *modbus_new_tcp(const char *ip, int port)
-{
-    modbus_t *ctx;
-    modbus_tcp_t *ctx_tcp;
-    size_t dest_size;
-    size_t ret_size;
+#ifdef SOCK_NONBLOCK
+    flags |= SOCK_NONBLOCK;
+#endif
 
-#if defined(OS_BSD)
-    /* MSG_NOSIGNAL is unsupported on *BSD so we install an ignore
-       handler for SIGPIPE. */
-    struct sigaction sa;
+    ctx->s = socket(PF_INET, flags, IPPROTO_UDP);
+    if (ctx->s < 0) {
+        return -1;
+    }
 
-    sa.sa_handler = SIG_IGN;
-    if (sigaction(SIGPIPE, &sa, NULL) < 0) {
-        /* The debug flag can't be set here... */
-        fprintf(stderr, "Could not install SIGPIPE handler.\n");
-        return NULL;
+#if !defined(SOCK_NONBLOCK) && defined(FIONBIO)
+#ifdef OS_WIN32
+    {
+        u_long loption = 1;
+        ioctlsocket(ctx->s, FIONBIO, &loption);
+    }
+#else
+    {
+        int option = 1;
+        ioctl(ctx->s, FIONBIO, &option);
     }
+#endif
 #endif
 
-    ctx = (modbus_t *) malloc(sizeof(modbus_t));
-    if (ctx == NULL) {
-        return NULL;
+    return ctx->s;
+}
+
+static int _modbus_udp_address(modbus_t *ctx, struct sockaddr_in *addr)
+{
+    modbus_udp_t *ctx_udp = ctx->backend_data;
+
+    memset(addr, 0, sizeof(struct sockaddr_in));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(ctx_udp->port);
+    if (ctx_udp->ip[0] == '0') {
+        addr->sin_addr.s_addr = htonl(INADDR_ANY);
+    } else if (inet_pton(addr->sin_family, ctx_udp->ip, &(addr->sin_addr)) <= 0) {
+        if (ctx->debug) {
+            fprintf(stderr, "Invalid IP address: %s\n", ctx_udp->ip);
+        }
+        errno = EINVAL;
+        return -1;
     }
-    _modbus_init_common(ctx);
 
-    /* Could be changed after to reach a remote serial Modbus device */
-    ctx->slave = MODBUS_TCP_SLAVE;
+    return 0;
+}
 
-    ctx->backend = &_modbus_tcp_backend;
+static ssize_t _modbus_udp_send(modbus_t *ctx, const uint8_t *req, int req_length)
+{
+    modbus_udp_t *ctx_udp = ctx->backend_data;
+
+    /* A new transaction, the rest of the previous datagram is dropped */
+    ctx_udp->dgram_start = 0;
+    ctx_udp->dgram_end = 0;
+    ctx_udp->frame_pending = FALSE;
+
+    if (!ctx_udp->client) {
+        /* Response to the sender of the indication */
+        return sendto(ctx->s,
+                      (const char *) req,
+                      req_length,
+                      MSG_NOSIGNAL,
+                      (struct sockaddr *) &ctx_udp->peer,
+                      ctx_udp->peer_length);
+    }
 
-    ctx->backend_data = (modbus_tcp_t *) malloc(sizeof(modbus_tcp_t));
-    if (ctx->backend_data == NULL) {
-        modbus_free(ctx);
-        errno = ENOMEM;
-        return NULL;
+    /* Kept to be sent again on timeout */
+    if (req_length <= (int) sizeof(ctx_udp->req)) {
+        memcpy(ctx_udp->req, req, req_length);
+        ctx_udp->req_length = req_length;
+        ctx_udp->req_pending = TRUE;
+        ctx_udp->nb_retries = 0;
     }
-    ctx_tcp = (modbus_tcp_t *) ctx->backend_data;
 
-    if (ip != NULL) {
-        dest_size = sizeof(char) * 16;
-        ret_size = strlcpy(ctx_tcp->ip, ip, dest_size);
-        if (ret_size == 0) {
-            fprintf(stderr, "The IP string is empty\n");
-            modbus_free(ctx);
-            errno = EINVAL;
-            return NULL;
+    return send(ctx->s, (const char *) req, req_length, MSG_NOSIGNAL);
+}
+
+/* Reads the next datagram, returns 1 when it can be consumed and 0 when it
+   has been ignored (empty or stale response) */
+static int _modbus_udp_read_datagram(modbus_t *ctx)
+{
+    modbus_udp_t *ctx_udp = ctx->backend_data;
+    struct sockaddr_storage peer;
+    socklen_t peer_length = sizeof(peer);
+    ssize_t rc;
+
+    rc = recvfrom(ctx->s,
+                  (char *) ctx_udp->dgram,
+                  sizeof(ctx_udp->dgram),
+                  0,
+                  (struct sockaddr *) &peer,
+                  &peer_length);
+    if (rc == -1) {
+        if (errno == EAGAIN || errno == EINTR) {
+            return 0;
         }
+        return -1;
+    }
 
-        if (ret_size >= dest_size) {
-            fprintf(stderr, "The IP string has been truncated\n");
-            modbus_free(ctx);
-            errno = EINVAL;
-            return NULL;
+    if (rc < _MODBUS_TCP_HEADER_LENGTH) {
+        return 0;
+    }
+
+    if (ctx_udp->client) {
+        /* Late responses to the requests sent before are dropped */
+        if (!ctx_udp->req_pending || ctx_udp->dgram[0] != ctx_udp->req[0] ||
+            ctx_udp->dgram[1] != ctx_udp->req[1]) {
+            if (ctx->debug) {
+                fprintf(stderr,
+                        "Datagram with transaction ID 0x%X ignored\n",
+                        (ctx_udp->dgram[0] << 8) + ctx_udp->dgram[1]);
+            }
+            return 0;
         }
+        ctx_udp->req_pending = FALSE;
     } else {
-        ctx_tcp->ip[0] = '0';
+        memcpy(&ctx_udp->peer, &peer, peer_length);
+        ctx_udp->peer_length = peer_length;
     }
-    ctx_tcp->port = port;
-    ctx_tcp->t_id = 0;
 
-    return ctx;
+    ctx_udp->dgram_start = 0;
+    ctx_udp->dgram_end = rc;
+
+    return 1;
 }
 
-modbus_t *modbus_new_tcp_pi(const char *node, const char *service)
+static ssize_t _modbus_udp_recv(modbus_t *ctx, uint8_t *rsp, int rsp_length)
 {
-    modbus_t *ctx;
-    modbus_tcp_pi_t *ctx_tcp_pi;
+    modbus_udp_t *ctx_udp = ctx->backend_data;
+    int length = ctx_udp->dgram_end - ctx_udp->dgram_start;
 
-    ctx = (modbus_t *) malloc(sizeof(modbus_t));
-    if (ctx == NULL) {
-        return NULL;
+    if (length > rsp_length) {
+        length = rsp_length;
     }
-    _modbus_init_common(ctx);
+    memcpy(rsp, ctx_udp->dgram + ctx_udp->dgram_start, length);
+    ctx_udp->dgram_start += length;
+    ctx_udp->frame_pending = TRUE;
 
-    /* Could be changed after to reach a remote serial Modbus device */
-    ctx->slave = MODBUS_TCP_SLAVE;
+    return length;
+}
 
-    ctx->backend = &_modbus_tcp_pi_backend;
+/* One frame per datagram: the frame is complete, the rest of the datagram is
+   dropped */
+static int _modbus_udp_check_integrity(modbus_t *ctx, uint8_t *msg, const int msg_length)
+{
+    modbus_udp_t *ctx_udp = ctx->backend_data;
 
-    ctx->backend_data = (modbus_tcp_pi_t *) malloc(sizeof(modbus_tcp_pi_t));
-    if (ctx->backend_data == NULL) {
-        modbus_free(ctx);
-        errno = ENOMEM;
-        return NULL;
-    }
-    ctx_tcp_pi = (modbus_tcp_pi_t *) ctx->backend_data;
-    ctx_tcp_pi->node = NULL;
-    ctx_tcp_pi->service = NULL;
+    ctx_udp->dgram_start = ctx_udp->dgram_end;
+    ctx_udp->frame_pending = FALSE;
 
-    if (node != NULL) {
-        ctx_tcp_pi->node = strdup(node);
-    } else {
-        /* The node argument can be empty to indicate any hosts */
-        ctx_tcp_pi->node = strdup("");
-    }
+    return _modbus_tcp_check_integrity(ctx, msg, msg_length);
+}
 
-    if (ctx_tcp_pi->node == NULL) {
-        modbus_free(ctx);
-        errno = ENOMEM;
-        return NULL;
-    }
+/* Waits for a datagram and reads it (like win32_ser_select() for the RTU
+   backend), the request is sent again when the response timeout expires */
+static int
+_modbus_udp_select(modbus_t *ctx, fd_set *rset, struct timeval *tv, int length_to_read)
+{
+    modbus_udp_t *ctx_udp = ctx->backend_data;
+    int s_rc;
 
-    if (service != NULL && service[0] != '\0') {
-        ctx_tcp_pi->service = strdup(service);
-    } else {
-        /* Default Modbus port number */
-        ctx_tcp_pi->service = strdup("502");
+    if (ctx_udp->dgram_start >= ctx_udp->dgram_end && ctx_udp->frame_pending) {
+        /* The datagram is shorter than its frame, the frame isn't completed
+           with the next datagram (maybe from another peer) */
+        if (ctx->debug) {
+            fprintf(stderr, "Truncated datagram dropped\n");
+        }
+        ctx_udp->frame_pending = FALSE;
+        errno = EMBBADDATA;
+        return -1;
     }
 
-    if (ctx_tcp_pi->service == NULL) {
-        modbus_free(ctx);
-        errno = ENOMEM;
-        return NULL;
-    }
+    while (ctx_udp->dgram_start >= ctx_udp->dgram_end) {
+        FD_ZERO(rset);
+        FD_SET(ctx->s, rset);
+        s_rc = select(ctx->s + 1, rset, NULL, NULL, tv);
+        if (s_rc == -1) {
+            if (errno == EINTR) {
+                if (ctx->debug) {
+                    fprintf(stderr, "A non blocked signal was caught\n");
+                }
+                continue;
+            }
+            return -1;
+        }
 
-    ctx_tcp_pi->t_id = 0;
+        if (s_rc == 0) {
+            if (ctx_udp->req_pending && ctx_udp->nb_retries < ctx_udp->retries &&
+                tv != NULL) {
+                if (ctx->debug) {
+                    fprintf(stderr, "Response timeout, request sent again\n");
+                }
+                ctx_udp->nb_retries++;
+                if (send(ctx->s,
+                         (const char *) ctx_udp->req,
+                         ctx_udp->req_length,
+                         MSG_NOSIGNAL) == -1) {
+                    return -1;
+                }
+                tv->tv_sec = ctx->response_timeout.tv_sec;
+                tv->tv_usec = ctx->response_timeout.tv_usec;
+                continue;
+            }
+            errno = ETIMEDOUT;
+            return -1;
+        }
+
+        if (_modbus_udp_read_datagram(ctx) == -1) {
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+static int _modbus_udp_connect(modbus_t *ctx)
+{
+    struct sockaddr_in addr;
+    modbus_udp_t *ctx_udp = ctx->backend_data;
+
+    if (_modbus_udp_address(ctx, &addr) == -1) {
+        return -1;
+    }
+
+    if (_modbus_udp_socket(ctx) == -1) {
+        return -1;
+    }
+
+    if (ctx->debug) {
+        printf("Connecting to %s:%d (UDP)\n", ctx_udp->ip, ctx_udp->port);
+    }
+
+    /* Only the datagrams of the server are received */
+    if (connect(ctx->s, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        close(ctx->s);
+        ctx->s = -1;
+        return -1;
+    }
+
+    ctx_udp->client = TRUE;
+    ctx_udp->req_pending = FALSE;
+    ctx_udp->dgram_start = 0;
+    ctx_udp->dgram_end = 0;
+    ctx_udp->frame_pending = FALSE;
+
+    return 0;
+}
+
+static int _modbus_udp_flush(modbus_t *ctx)
+{
+    modbus_udp_t *ctx_udp = ctx->backend_data;
+    int rc_sum = ctx_udp->dgram_end - ctx_udp->dgram_start;
+    int rc;
+
+    ctx_udp->dgram_start = 0;
+    ctx_udp->dgram_end = 0;
+    ctx_udp->frame_pending = FALSE;
+
+    do {
+        char devnull[MODBUS_TCP_MAX_ADU_LENGTH];
+#ifndef OS_WIN32
+        rc = recv(ctx->s, devnull, sizeof(devnull), MSG_DONTWAIT);
+#else
+        fd_set rset;
+        struct timeval tv;
+
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+        FD_ZERO(&rset);
+        FD_SET(ctx->s, &rset);
+        rc = select(ctx->s + 1, &rset, NULL, NULL, &tv);
+        if (rc == 1) {
+            rc = recv(ctx->s, devnull, sizeof(devnull), 0);
+        }
+#endif
+        if (rc > 0) {
+            rc_sum += rc;
+        }
+    } while (rc > 0);
+
+    return rc_sum;
+}
+
+#ifdef HAVE_SYS_UN_H
+/* Modbus over Unix domain stream sockets: TCP framing (MBAP) between
+   processes of the same host, without the TCP/IP stack */
+static int _modbus_unix_address(modbus_t *ctx, struct sockaddr_un *addr)
+{
+    modbus_unix_t *ctx_unix = ctx->backend_data;
+
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    if (strlcpy(addr->sun_path, ctx_unix->path, sizeof(addr->sun_path)) >=
+        sizeof(addr->sun_path)) {
+        if (ctx->debug) {
+            fprintf(stderr, "The socket path is too long: %s\n", ctx_unix->path);
+        }
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int _modbus_unix_connect(modbus_t *ctx)
+{
+    struct sockaddr_un addr;
+    int flags = SOCK_STREAM;
+    int rc;
+
+    if (_modbus_unix_address(ctx, &addr) == -1) {
+        return -1;
+    }
+
+#ifdef SOCK_CLOEXEC
+    flags |= SOCK_CLOEXEC;
+#endif
+
+#ifdef SOCK_NONBLOCK
+    flags |= SOCK_NONBLOCK;
+#endif
+
+    ctx->s = socket(AF_UNIX, flags, 0);
+    if (ctx->s < 0) {
+        return -1;
+    }
+
+    if (ctx->debug) {
+        printf("Connecting to %s\n", addr.sun_path);
+    }
+
+    rc = _connect(ctx->s, (struct sockaddr *) &addr, sizeof(addr), &ctx->response_timeout);
+    if (rc == -1) {
+        close(ctx->s);
+        ctx->s = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void _modbus_unix_free(modbus_t *ctx)
+{
+    if (ctx->backend_data) {
+        modbus_unix_t *ctx_unix = ctx->backend_data;
+        free(ctx_unix->path);
+        free(ctx->backend_data);
+    }
+
+    free(ctx);
+}
+#endif
+
+static int _modbus_loopback_flush(modbus_t *ctx)
+{
+    modbus_loopback_t *ctx_loopback = ctx->backend_data;
+    int rc = ctx_loopback->queue_end - ctx_loopback->queue_start;
+
+    ctx_loopback->queue_start = 0;
+    ctx_loopback->queue_end = 0;
+
+    return rc;
+}
+
+/* The generic code still puts ctx->s in the fd_set given to select(), it is
+   set to 0 while connected and never used for I/O */
+static int _modbus_loopback_connect(modbus_t *ctx)
+{
+    modbus_loopback_t *ctx_loopback = ctx->backend_data;
+
+    _modbus_loopback_flush(ctx);
+    _modbus_loopback_flush(ctx_loopback->peer);
+    ctx->s = 0;
+
+    return 0;
+}
+
+static void _modbus_loopback_close(modbus_t *ctx)
+{
+    ctx->s = -1;
+}
+
+static ssize_t _modbus_loopback_send(modbus_t *ctx, const uint8_t *req, int req_length)
+{
+    modbus_loopback_t *ctx_loopback = ctx->backend_data;
+    modbus_loopback_t *peer_loopback = ctx_loopback->peer->backend_data;
+
+    if (ctx->s < 0) {
+        errno = ENOTCONN;
+        return -1;
+    }
+
+    if (peer_loopback->queue_start == peer_loopback->queue_end) {
+        peer_loopback->queue_start = 0;
+        peer_loopback->queue_end = 0;
+    }
+
+    if (req_length > (int) sizeof(peer_loopback->queue) - peer_loopback->queue_end) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    memcpy(peer_loopback->queue + peer_loopback->queue_end, req, req_length);
+    peer_loopback->queue_end += req_length;
+
+    return req_length;
+}
+
+static ssize_t _modbus_loopback_recv(modbus_t *ctx, uint8_t *rsp, int rsp_length)
+{
+    modbus_loopback_t *ctx_loopback = ctx->backend_data;
+    int length = ctx_loopback->queue_end - ctx_loopback->queue_start;
+
+    if (length > rsp_length) {
+        length = rsp_length;
+    }
+
+    memcpy(rsp, ctx_loopback->queue + ctx_loopback->queue_start, length);
+    ctx_loopback->queue_start += length;
+
+    return length;
+}
+
+/* Answers the indications queued for the server side, as a server loop would
+   do with modbus_receive() and modbus_reply() */
+static void _modbus_loopback_serve(modbus_t *server)
+{
+    modbus_loopback_t *server_loopback = server->backend_data;
+    uint8_t req[MODBUS_TCP_MAX_ADU_LENGTH];
+    int rc;
+
+    while (server_loopback->queue_start != server_loopback->queue_end) {
+        rc = modbus_receive(server, req);
+        if (rc == -1) {
+            _modbus_loopback_flush(server);
+            break;
+        }
+        if (rc > 0) {
+            modbus_reply(server, req, rc, server_loopback->mb_mapping);
+        }
+    }
+}
+
+/* Never blocks: the data is either in the queue or will not come */
+static int
+_modbus_loopback_select(modbus_t *ctx, fd_set *rset, struct timeval *tv, int length_to_read)
+{
+    modbus_loopback_t *ctx_loopback = ctx->backend_data;
+
+    if (ctx_loopback->queue_start == ctx_loopback->queue_end &&
+        ctx_loopback->mb_mapping == NULL) {
+        _modbus_loopback_serve(ctx_loopback->peer);
+    }
+
+    if (ctx_loopback->queue_start == ctx_loopback->queue_end) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    return 1;
+}
+
+/* The client owns the server side, which is never returned to the caller */
+static void _modbus_loopback_free(modbus_t *ctx)
+{
+    if (ctx->backend_data) {
+        modbus_loopback_t *ctx_loopback = ctx->backend_data;
+        if (ctx_loopback->mb_mapping == NULL && ctx_loopback->peer != NULL) {
+            _modbus_loopback_free(ctx_loopback->peer);
+        }
+        free(ctx->backend_data);
+    }
+
+    free(ctx);
+}
+
+// clang-format off
+const modbus_backend_t _modbus_tcp_backend = {
+    _MODBUS_BACKEND_TYPE_TCP,
+    _MODBUS_TCP_HEADER_LENGTH,
+    _MODBUS_TCP_CHECKSUM_LENGTH,
+    MODBUS_TCP_MAX_ADU_LENGTH,
+    _modbus_set_slave,
+    _modbus_tcp_build_request_basis,
+    _modbus_tcp_build_response_basis,
+    _modbus_tcp_get_response_tid,
+    _modbus_tcp_send_msg_pre,
+    _modbus_tcp_send,
+    _modbus_tcp_receive,
+    _modbus_tcp_recv,
+    _modbus_tcp_check_integrity,
+    _modbus_tcp_pre_check_confirmation,
+    _modbus_tcp_connect,
+    _modbus_tcp_is_connected,
+    _modbus_tcp_close,
+    _modbus_tcp_flush,
+    _modbus_tcp_select,
+    _modbus_tcp_free,
+    NULL
+};
+
+const modbus_backend_t _modbus_tcp_pi_backend = {
+    _MODBUS_BACKEND_TYPE_TCP,
+    _MODBUS_TCP_HEADER_LENGTH,
+    _MODBUS_TCP_CHECKSUM_LENGTH,
+    MODBUS_TCP_MAX_ADU_LENGTH,
+    _modbus_set_slave,
+    _modbus_tcp_build_request_basis,
+    _modbus_tcp_build_response_basis,
+    _modbus_tcp_get_response_tid,
+    _modbus_tcp_send_msg_pre,
+    _modbus_tcp_send,
+    _modbus_tcp_receive,
+    _modbus_tcp_recv,
+    _modbus_tcp_check_integrity,
+    _modbus_tcp_pre_check_confirmation,
+    _modbus_tcp_pi_connect,
+    _modbus_tcp_is_connected,
+    _modbus_tcp_close,
+    _modbus_tcp_flush,
+    _modbus_tcp_select,
+    _modbus_tcp_pi_free,
+    NULL
+};
+
+const modbus_backend_t _modbus_rtu_tcp_backend = {
+    _MODBUS_BACKEND_TYPE_RTU_TCP,
+    _MODBUS_RTU_TCP_HEADER_LENGTH,
+    _MODBUS_RTU_TCP_CHECKSUM_LENGTH,
+    MODBUS_RTU_TCP_MAX_ADU_LENGTH,
+    _modbus_rtu_tcp_set_slave,
+    _modbus_rtu_tcp_build_request_basis,
+    _modbus_rtu_tcp_build_response_basis,
+    _modbus_rtu_tcp_get_response_tid,
+    _modbus_rtu_tcp_send_msg_pre,
+    _modbus_tcp_send,
+    _modbus_tcp_receive,
+    _modbus_tcp_recv,
+    _modbus_rtu_tcp_check_integrity,
+    _modbus_rtu_tcp_pre_check_confirmation,
+    _modbus_tcp_connect,
+    _modbus_tcp_is_connected,
+    _modbus_tcp_close,
+    _modbus_tcp_flush,
+    _modbus_tcp_select,
+    _modbus_tcp_free,
+    NULL
+};
+
+const modbus_backend_t _modbus_udp_backend = {
+    _MODBUS_BACKEND_TYPE_TCP,
+    _MODBUS_TCP_HEADER_LENGTH,
+    _MODBUS_TCP_CHECKSUM_LENGTH,
+    MODBUS_TCP_MAX_ADU_LENGTH,
+    _modbus_set_slave,
+    _modbus_tcp_build_request_basis,
+    _modbus_tcp_build_response_basis,
+    _modbus_tcp_get_response_tid,
+    _modbus_tcp_send_msg_pre,
+    _modbus_udp_send,
+    _modbus_tcp_receive,
+    _modbus_udp_recv,
+    _modbus_udp_check_integrity,
+    _modbus_tcp_pre_check_confirmation,
+    _modbus_udp_connect,
+    _modbus_tcp_is_connected,
+    _modbus_tcp_close,
+    _modbus_udp_flush,
+    _modbus_udp_select,
+    _modbus_tcp_free,
+    NULL
+};
+
+#ifdef HAVE_SYS_UN_H
+const modbus_backend_t _modbus_unix_backend = {
+    _MODBUS_BACKEND_TYPE_TCP,
+    _MODBUS_TCP_HEADER_LENGTH,
+    _MODBUS_TCP_CHECKSUM_LENGTH,
+    MODBUS_TCP_MAX_ADU_LENGTH,
+    _modbus_set_slave,
+    _modbus_tcp_build_request_basis,
+    _modbus_tcp_build_response_basis,
+    _modbus_tcp_get_response_tid,
+    _modbus_tcp_send_msg_pre,
+    _modbus_tcp_send,
+    _modbus_tcp_receive,
+    _modbus_tcp_recv,
+    _modbus_tcp_check_integrity,
+    _modbus_tcp_pre_check_confirmation,
+    _modbus_unix_connect,
+    _modbus_tcp_is_connected,
+    _modbus_tcp_close,
+    _modbus_tcp_flush,
+    _modbus_tcp_select,
+    _modbus_unix_free,
+    NULL
+};
+#endif
+
+const modbus_backend_t _modbus_loopback_backend = {
+    _MODBUS_BACKEND_TYPE_TCP,
+    _MODBUS_TCP_HEADER_LENGTH,
+    _MODBUS_TCP_CHECKSUM_LENGTH,
+    MODBUS_TCP_MAX_ADU_LENGTH,
+    _modbus_set_slave,
+    _modbus_tcp_build_request_basis,
+    _modbus_tcp_build_response_basis,
+    _modbus_tcp_get_response_tid,
+    _modbus_tcp_send_msg_pre,
+    _modbus_loopback_send,
+    _modbus_tcp_receive,
+    _modbus_loopback_recv,
+    _modbus_tcp_check_integrity,
+    _modbus_tcp_pre_check_confirmation,
+    _modbus_loopback_connect,
+    _modbus_tcp_is_connected,
+    _modbus_loopback_close,
+    _modbus_loopback_flush,
+    _modbus_loopback_select,
+    _modbus_loopback_free,
+    NULL
+};
+
+// clang-format on
+
+modbus_t *modbus_new_tcp(const char *ip, int port)
+{
+    modbus_t *ctx;
+    modbus_tcp_t *ctx_tcp;
+    size_t dest_size;
+    size_t ret_size;
+
+#if defined(OS_BSD)
+    /* MSG_NOSIGNAL is unsupported on *BSD so we install an ignore
+       handler for SIGPIPE. */
+    struct sigaction sa;
+
+    sa.sa_handler = SIG_IGN;
+    if (sigaction(SIGPIPE, &sa, NULL) < 0) {
+        /* The debug flag can't be set here... */
+        fprintf(stderr, "Could not install SIGPIPE handler.\n");
+        return NULL;
+    }
+#endif
+
+    ctx = (modbus_t *) malloc(sizeof(modbus_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    _modbus_init_common(ctx);
+
+    /* Could be changed after to reach a remote serial Modbus device */
+    ctx->slave = MODBUS_TCP_SLAVE;
+
+    ctx->backend = &_modbus_tcp_backend;
+
+    ctx->backend_data = (modbus_tcp_t *) malloc(sizeof(modbus_tcp_t));
+    if (ctx->backend_data == NULL) {
+        modbus_free(ctx);
+        errno = ENOMEM;
+        return NULL;
+    }
+    ctx_tcp = (modbus_tcp_t *) ctx->backend_data;
+
+    if (ip != NULL) {
+        dest_size = sizeof(char) * 16;
+        ret_size = strlcpy(ctx_tcp->ip, ip, dest_size);
+        if (ret_size == 0) {
+            fprintf(stderr, "The IP string is empty\n");
+            modbus_free(ctx);
+            errno = EINVAL;
+            return NULL;
+        }
+
+        if (ret_size >= dest_size) {
+            fprintf(stderr, "The IP string has been truncated\n");
+            modbus_free(ctx);
+            errno = EINVAL;
+            return NULL;
+        }
+    } else {
+        ctx_tcp->ip[0] = '0';
+    }
+    ctx_tcp->port = port;
+    ctx_tcp->t_id = 0;
+
+    return ctx;
+}
+
+modbus_t *modbus_new_tcp_pi(const char *node, const char *service)
+{
+    modbus_t *ctx;
+    modbus_tcp_pi_t *ctx_tcp_pi;
+
+    ctx = (modbus_t *) malloc(sizeof(modbus_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    _modbus_init_common(ctx);
+
+    /* Could be changed after to reach a remote serial Modbus device */
+    ctx->slave = MODBUS_TCP_SLAVE;
+
+    ctx->backend = &_modbus_tcp_pi_backend;
+
+    ctx->backend_data = (modbus_tcp_pi_t *) malloc(sizeof(modbus_tcp_pi_t));
+    if (ctx->backend_data == NULL) {
+        modbus_free(ctx);
+        errno = ENOMEM;
+        return NULL;
+    }
+    ctx_tcp_pi = (modbus_tcp_pi_t *) ctx->backend_data;
+    ctx_tcp_pi->node = NULL;
+    ctx_tcp_pi->service = NULL;
+
+    if (node != NULL) {
+        ctx_tcp_pi->node = strdup(node);
+    } else {
+        /* The node argument can be empty to indicate any hosts */
+        ctx_tcp_pi->node = strdup("");
+    }
+
+    if (ctx_tcp_pi->node == NULL) {
+        modbus_free(ctx);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (service != NULL && service[0] != '\0') {
+        ctx_tcp_pi->service = strdup(service);
+    } else {
+        /* Default Modbus port number */
+        ctx_tcp_pi->service = strdup("502");
+    }
+
+    if (ctx_tcp_pi->service == NULL) {
+        modbus_free(ctx);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    ctx_tcp_pi->t_id = 0;
+
+    return ctx;
+}
+
+/* The context talks to a serial device server tunneling RTU frames over TCP.
+   As a server, modbus_tcp_listen() and modbus_tcp_accept() are used. */
+modbus_t *modbus_new_rtu_tcp(const char *ip, int port)
+{
+    modbus_t *ctx = modbus_new_tcp(ip, port);
+
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    /* The slave must be set (no default unit as in TCP) */
+    ctx->slave = -1;
+    ctx->backend = &_modbus_rtu_tcp_backend;
+
+    return ctx;
+}
+
+/* The context talks to a server of the same host listening on the Unix
+   domain socket at path */
+modbus_t *modbus_new_unix(const char *path)
+{
+#ifdef HAVE_SYS_UN_H
+    modbus_t *ctx;
+    modbus_unix_t *ctx_unix;
+
+    if (path == NULL || path[0] == '\0') {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    ctx = (modbus_t *) malloc(sizeof(modbus_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    _modbus_init_common(ctx);
+
+    ctx->slave = MODBUS_TCP_SLAVE;
+
+    ctx->backend = &_modbus_unix_backend;
+
+    ctx->backend_data = (modbus_unix_t *) malloc(sizeof(modbus_unix_t));
+    if (ctx->backend_data == NULL) {
+        modbus_free(ctx);
+        errno = ENOMEM;
+        return NULL;
+    }
+    ctx_unix = (modbus_unix_t *) ctx->backend_data;
+    ctx_unix->t_id = 0;
+    ctx_unix->path = strdup(path);
+    if (ctx_unix->path == NULL) {
+        modbus_free(ctx);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return ctx;
+#else
+    (void) path;
+    errno = ENOTSUP;
+    return NULL;
+#endif
+}
+
+/* Listens on the Unix domain socket, a stale socket file left by a previous
+   server is removed */
+int modbus_unix_listen(modbus_t *ctx, int nb_connection)
+{
+#ifdef HAVE_SYS_UN_H
+    struct sockaddr_un addr;
+    struct stat st;
+    int flags = SOCK_STREAM;
+    int new_s;
+
+    if (ctx == NULL || ctx->backend != &_modbus_unix_backend) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (_modbus_unix_address(ctx, &addr) == -1) {
+        return -1;
+    }
+
+#ifdef SOCK_CLOEXEC
+    flags |= SOCK_CLOEXEC;
+#endif
+
+    /* A socket left by a server that is gone is removed, but not the one of a
+       running server (the connection succeeds) */
+    if (stat(addr.sun_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        int probe = socket(AF_UNIX, flags, 0);
+        int rc;
+
+        if (probe == -1) {
+            return -1;
+        }
+        rc = connect(probe, (struct sockaddr *) &addr, sizeof(addr));
+        if (rc == 0) {
+            close(probe);
+            if (ctx->debug) {
+                fprintf(stderr, "ERROR %s is used by a running server\n", addr.sun_path);
+            }
+            errno = EADDRINUSE;
+            return -1;
+        }
+        if (errno == ECONNREFUSED) {
+            unlink(addr.sun_path);
+        }
+        close(probe);
+    }
+
+    new_s = socket(AF_UNIX, flags, 0);
+    if (new_s == -1) {
+        return -1;
+    }
+
+    if (bind(new_s, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        close(new_s);
+        return -1;
+    }
+
+    if (listen(new_s, nb_connection) == -1) {
+        close(new_s);
+        return -1;
+    }
+
+    return new_s;
+#else
+    (void) ctx;
+    (void) nb_connection;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+int modbus_unix_accept(modbus_t *ctx, int *s)
+{
+#ifdef HAVE_SYS_UN_H
+    if (ctx == NULL || ctx->backend != &_modbus_unix_backend) {
+        errno = EINVAL;
+        return -1;
+    }
+
+#ifdef HAVE_ACCEPT4
+    /* Inherit socket flags and use accept4 call */
+    ctx->s = accept4(*s, NULL, NULL, SOCK_CLOEXEC);
+#else
+    ctx->s = accept(*s, NULL, NULL);
+#endif
+
+    if (ctx->s < 0) {
+        return -1;
+    }
+
+    if (ctx->debug) {
+        printf("Client connection accepted on %s.\n",
+               ((modbus_unix_t *) ctx->backend_data)->path);
+    }
+
+    return ctx->s;
+#else
+    (void) ctx;
+    (void) s;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+static modbus_t *_modbus_loopback_new_side(modbus_mapping_t *mb_mapping)
+{
+    modbus_t *ctx;
+    modbus_loopback_t *ctx_loopback;
+
+    ctx = (modbus_t *) malloc(sizeof(modbus_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    _modbus_init_common(ctx);
+
+    ctx->slave = MODBUS_TCP_SLAVE;
+
+    ctx->backend = &_modbus_loopback_backend;
+
+    ctx->backend_data = (modbus_loopback_t *) malloc(sizeof(modbus_loopback_t));
+    if (ctx->backend_data == NULL) {
+        modbus_free(ctx);
+        errno = ENOMEM;
+        return NULL;
+    }
+    ctx_loopback = (modbus_loopback_t *) ctx->backend_data;
+    ctx_loopback->t_id = 0;
+    ctx_loopback->peer = NULL;
+    ctx_loopback->mb_mapping = mb_mapping;
+    ctx_loopback->queue_start = 0;
+    ctx_loopback->queue_end = 0;
+
+    return ctx;
+}
+
+modbus_t *modbus_new_loopback(modbus_mapping_t *mb_mapping)
+{
+    modbus_t *ctx;
+    modbus_t *server;
+
+    if (mb_mapping == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    ctx = _modbus_loopback_new_side(NULL);
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    server = _modbus_loopback_new_side(mb_mapping);
+    if (server == NULL) {
+        modbus_free(ctx);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* The server side is always ready to receive */
+    server->s = 0;
+    ((modbus_loopback_t *) server->backend_data)->peer = ctx;
+    ((modbus_loopback_t *) ctx->backend_data)->peer = server;
+
+    return ctx;
+}
+
+modbus_t *modbus_new_udp(const char *ip, int port)
+{
+    modbus_t *ctx;
+    modbus_udp_t *ctx_udp;
+    size_t dest_size;
+    size_t ret_size;
+
+    ctx = (modbus_t *) malloc(sizeof(modbus_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    _modbus_init_common(ctx);
+
+    /* Could be changed after to reach a remote serial Modbus device */
+    ctx->slave = MODBUS_TCP_SLAVE;
+
+    ctx->backend = &_modbus_udp_backend;
+
+    ctx->backend_data = (modbus_udp_t *) malloc(sizeof(modbus_udp_t));
+    if (ctx->backend_data == NULL) {
+        modbus_free(ctx);
+        errno = ENOMEM;
+        return NULL;
+    }
+    ctx_udp = (modbus_udp_t *) ctx->backend_data;
+    memset(ctx_udp, 0, sizeof(modbus_udp_t));
+
+    if (ip != NULL) {
+        dest_size = sizeof(char) * 16;
+        ret_size = strlcpy(ctx_udp->ip, ip, dest_size);
+        if (ret_size == 0 || ret_size >= dest_size) {
+            fprintf(stderr, "Invalid IP string\n");
+            modbus_free(ctx);
+            errno = EINVAL;
+            return NULL;
+        }
+    } else {
+        ctx_udp->ip[0] = '0';
+    }
+    ctx_udp->port = port;
+    ctx_udp->t_id = 0;
+    ctx_udp->retries = 0;
 
     return ctx;
 }
+
+/* Binds the socket of a UDP server, the requests are then received with
+   modbus_receive() */
+int modbus_udp_bind(modbus_t *ctx)
+{
+    struct sockaddr_in addr;
+    int enable;
+
+    if (ctx == NULL || ctx->backend != &_modbus_udp_backend) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (_modbus_udp_address(ctx, &addr) == -1) {
+        return -1;
+    }
+
+    if (_modbus_udp_socket(ctx) == -1) {
+        return -1;
+    }
+
+    enable = 1;
+    if (setsockopt(ctx->s, SOL_SOCKET, SO_REUSEADDR, (const char *) &enable, sizeof(enable)) ==
+            -1 ||
+        bind(ctx->s, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        close(ctx->s);
+        ctx->s = -1;
+        return -1;
+    }
+
+    return ctx->s;
+}
+
+int modbus_udp_set_retries(modbus_t *ctx, int retries)
+{
+    if (ctx == NULL || ctx->backend != &_modbus_udp_backend || retries < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ((modbus_udp_t *) ctx->backend_data)->retries = retries;
+    return 0;
+}
+
+int modbus_udp_get_retries(modbus_t *ctx)
+{
+    if (ctx == NULL || ctx->backend != &_modbus_udp_backend) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return ((modbus_udp_t *) ctx->backend_data)->retries;
+}
+
+/* Sends the pending requests of a batch, in a single system call when
+   sendmmsg() is available */
+static int _modbus_udp_send_batch(modbus_t *ctx,
+                                  uint8_t (*reqs)[_MODBUS_TCP_PRESET_REQ_LENGTH],
+                                  const modbus_udp_read_t *reads,
+                                  int nb_reads)
+{
+#if HAVE_SENDMMSG
+    struct mmsghdr msgs[MODBUS_UDP_MAX_BATCH];
+    struct iovec iovecs[MODBUS_UDP_MAX_BATCH];
+    int nb_msgs = 0;
+    int sent = 0;
+    int i;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (i = 0; i < nb_reads; i++) {
+        if (reads[i].rc != -1) {
+            continue;
+        }
+        iovecs[nb_msgs].iov_base = reqs[i];
+        iovecs[nb_msgs].iov_len = _MODBUS_TCP_PRESET_REQ_LENGTH;
+        msgs[nb_msgs].msg_hdr.msg_iov = &iovecs[nb_msgs];
+        msgs[nb_msgs].msg_hdr.msg_iovlen = 1;
+        nb_msgs++;
+    }
+
+    while (sent < nb_msgs) {
+        int rc = sendmmsg(ctx->s, msgs + sent, nb_msgs - sent, MSG_NOSIGNAL);
+        if (rc == -1) {
+            return -1;
+        }
+        sent += rc;
+    }
+#else
+    int i;
+
+    for (i = 0; i < nb_reads; i++) {
+        if (reads[i].rc == -1 && send(ctx->s,
+                                      (const char *) reqs[i],
+                                      _MODBUS_TCP_PRESET_REQ_LENGTH,
+                                      MSG_NOSIGNAL) == -1) {
+            return -1;
+        }
+    }
+#endif
+
+    return 0;
+}
+
+/* Matches a response of a batch with its request by transaction ID */
+static void _modbus_udp_batch_response(modbus_t *ctx,
+                                       uint8_t (*reqs)[_MODBUS_TCP_PRESET_REQ_LENGTH],
+                                       modbus_udp_read_t *reads,
+                                       int nb_reads,
+                                       uint8_t *rsp,
+                                       int rsp_length)
+{
+    int i;
+
+    if (rsp_length < _MODBUS_TCP_HEADER_LENGTH + 1) {
+        return;
+    }
+
+    for (i = 0; i < nb_reads; i++) {
+        int rc;
+        int j;
+
+        if (reads[i].rc != -1 || reqs[i][0] != rsp[0] || reqs[i][1] != rsp[1]) {
+            continue;
+        }
+
+        rc = _modbus_check_response(ctx, reqs[i], rsp, rsp_length);
+        if (rc == -1) {
+            /* Exceptions and invalid data aren't sent again */
+            reads[i].rc = -2;
+            reads[i].error = errno;
+            return;
+        }
+
+        for (j = 0; j < rc; j++) {
+            reads[i].dest[j] = (rsp[_MODBUS_TCP_HEADER_LENGTH + 2 + (j << 1)] << 8) |
+                               rsp[_MODBUS_TCP_HEADER_LENGTH + 3 + (j << 1)];
+        }
+        reads[i].rc = rc;
+        reads[i].error = 0;
+        return;
+    }
+
+    if (ctx->debug) {
+        fprintf(stderr,
+                "Datagram with transaction ID 0x%X ignored\n",
+                (rsp[0] << 8) + rsp[1]);
+    }
+}
+
+/* Reads the holding registers of several slaves or ranges at once: all the
+   requests are sent before waiting for the responses which are matched by
+   transaction ID in any order. The unanswered requests are sent again up to
+   the number of retries. The result of each read is stored in its rc field
+   (nb or -1 and the errno value in error).
+
+   The function shall return the number of successful reads or -1 if an
+   error occurred. */
+int modbus_udp_read_registers_batch(modbus_t *ctx, modbus_udp_read_t *reads, int nb_reads)
+{
+    uint8_t reqs[MODBUS_UDP_MAX_BATCH][_MODBUS_TCP_PRESET_REQ_LENGTH];
+    modbus_udp_t *ctx_udp;
+    int saved_slave;
+    int attempt;
+    int nb_ok = 0;
+    int i;
+
+    if (ctx == NULL || ctx->backend != &_modbus_udp_backend || reads == NULL ||
+        nb_reads < 1 || nb_reads > MODBUS_UDP_MAX_BATCH) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ctx_udp = ctx->backend_data;
+    if (!ctx_udp->client) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < nb_reads; i++) {
+        if (reads[i].nb < 1 || reads[i].nb > MODBUS_MAX_READ_REGISTERS ||
+            reads[i].dest == NULL) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    saved_slave = ctx->slave;
+    for (i = 0; i < nb_reads; i++) {
+        int req_length;
+
+        ctx->slave = reads[i].slave;
+        req_length = ctx->backend->build_request_basis(
+            ctx, MODBUS_FC_READ_HOLDING_REGISTERS, reads[i].addr, reads[i].nb, reqs[i]);
+        ctx->backend->send_msg_pre(reqs[i], req_length);
+        reads[i].rc = -1;
+        reads[i].error = ETIMEDOUT;
+    }
+    ctx->slave = saved_slave;
+
+    /* The single request API must not match these responses */
+    ctx_udp->req_pending = FALSE;
+    ctx_udp->dgram_start = 0;
+    ctx_udp->dgram_end = 0;
+    ctx_udp->frame_pending = FALSE;
+
+    for (attempt = 0; attempt <= ctx_udp->retries && nb_ok < nb_reads; attempt++) {
+        struct timeval tv = ctx->response_timeout;
+
+        if (_modbus_udp_send_batch(ctx, reqs, reads, nb_reads) == -1) {
+            return -1;
+        }
+
+        for (;;) {
+            fd_set rset;
+            int rc;
+
+            nb_ok = 0;
+            for (i = 0; i < nb_reads; i++) {
+                if (reads[i].rc != -1) {
+                    nb_ok++;
+                }
+            }
+            if (nb_ok == nb_reads) {
+                break;
+            }
+
+            FD_ZERO(&rset);
+            FD_SET(ctx->s, &rset);
+            /* The remaining time is updated by select() on Linux */
+            rc = select(ctx->s + 1, &rset, NULL, NULL, &tv);
+            if (rc == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            if (rc == 0) {
+                break;
+            }
+
+#if HAVE_RECVMMSG
+            {
+                uint8_t rsps[MODBUS_UDP_MAX_BATCH][MODBUS_TCP_MAX_ADU_LENGTH];
+                struct mmsghdr msgs[MODBUS_UDP_MAX_BATCH];
+                struct iovec iovecs[MODBUS_UDP_MAX_BATCH];
+                int j;
+
+                memset(msgs, 0, sizeof(msgs));
+                for (j = 0; j < nb_reads; j++) {
+                    iovecs[j].iov_base = rsps[j];
+                    iovecs[j].iov_len = MODBUS_TCP_MAX_ADU_LENGTH;
+                    msgs[j].msg_hdr.msg_iov = &iovecs[j];
+                    msgs[j].msg_hdr.msg_iovlen = 1;
+                }
+
+                rc = recvmmsg(ctx->s, msgs, nb_reads, MSG_DONTWAIT, NULL);
+                for (j = 0; j < rc; j++) {
+                    _modbus_udp_batch_response(
+                        ctx, reqs, reads, nb_reads, rsps[j], msgs[j].msg_len);
+                }
+            }
+#else
+            {
+                uint8_t rsp[MODBUS_TCP_MAX_ADU_LENGTH];
+
+                rc = recv(ctx->s, (char *) rsp, sizeof(rsp), 0);
+                if (rc > 0) {
+                    _modbus_udp_batch_response(ctx, reqs, reads, nb_reads, rsp, rc);
+                }
+            }
+#endif
+            if (rc == -1 && errno != EAGAIN && errno != EINTR) {
+                return -1;
+            }
+        }
+    }
+
+    nb_ok = 0;
+    for (i = 0; i < nb_reads; i++) {
+        if (reads[i].rc == -2) {
+            reads[i].rc = -1;
+        } else if (reads[i].rc != -1) {
+            nb_ok++;
+        }
+    }
+
+    return nb_ok;
+}
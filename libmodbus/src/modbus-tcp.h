@@ -43,6 +43,44 @@ MODBUS_API modbus_t *modbus_new_tcp(const char *ip_address, int port);
 MODBUS_API int modbus_tcp_listen(modbus_t *ctx, int nb_connection);
 MODBUS_API int modbus_tcp_accept(modbus_t *ctx, int *s);
 
+/* RTU frames tunneled over TCP, same ADU as on the serial line */
+#define MODBUS_RTU_TCP_MAX_ADU_LENGTH 256
+
+MODBUS_API modbus_t *modbus_new_rtu_tcp(const char *ip_address, int port);
+
+/* MBAP frames over a Unix domain stream socket (same host) */
+MODBUS_API modbus_t *modbus_new_unix(const char *path);
+MODBUS_API int modbus_unix_listen(modbus_t *ctx, int nb_connection);
+MODBUS_API int modbus_unix_accept(modbus_t *ctx, int *s);
+
+/* Client context joined to a server context of the same process by memory
+   queues, without any system call. The request is answered with mb_mapping in
+   the calling thread when the client waits for the confirmation. */
+MODBUS_API modbus_t *modbus_new_loopback(modbus_mapping_t *mb_mapping);
+
+/* Modbus UDP, MBAP frames in datagrams */
+MODBUS_API modbus_t *modbus_new_udp(const char *ip_address, int port);
+MODBUS_API int modbus_udp_bind(modbus_t *ctx);
+MODBUS_API int modbus_udp_set_retries(modbus_t *ctx, int retries);
+MODBUS_API int modbus_udp_get_retries(modbus_t *ctx);
+
+#define MODBUS_UDP_MAX_BATCH 64
+
+/* Read holding registers request of a batch */
+typedef struct _modbus_udp_read {
+    int slave;
+    int addr;
+    int nb;
+    uint16_t *dest;
+    /* Set by modbus_udp_read_registers_batch(): nb or -1 and the errno value in
+       error */
+    int rc;
+    int error;
+} modbus_udp_read_t;
+
+MODBUS_API int
+modbus_udp_read_registers_batch(modbus_t *ctx, modbus_udp_read_t *reads, int nb_reads);
+
 MODBUS_API modbus_t *modbus_new_tcp_pi(const char *node, const char *service);
 MODBUS_API int modbus_tcp_pi_listen(modbus_t *ctx, int nb_connection);
 MODBUS_API int modbus_tcp_pi_accept(modbus_t *ctx, int *s);
@@ -343,6 +343,99 @@ compute_data_length_after_meta(modbus_t *ctx, uint8_t *msg, msg_type_t msg_type)
     return length;
 }
 
+/* Receives a message delimited by a line silence (t3.5 in RTU) instead of a
+   length computed from the function code, so a garbage or unknown frame is
+   skipped as soon as the line is quiet again. The first byte is awaited
+   with the indication or response timeout. */
+static int receive_msg_silence(modbus_t *ctx, uint8_t *msg, msg_type_t msg_type, int silence)
+{
+    int rc;
+    fd_set rset;
+    struct timeval tv;
+    struct timeval *p_tv;
+    int msg_length = 0;
+    int overflow = FALSE;
+    uint8_t discard[MAX_MESSAGE_LENGTH];
+
+    if (msg_type == MSG_INDICATION) {
+        if (ctx->indication_timeout.tv_sec == 0 && ctx->indication_timeout.tv_usec == 0) {
+            p_tv = NULL;
+        } else {
+            tv.tv_sec = ctx->indication_timeout.tv_sec;
+            tv.tv_usec = ctx->indication_timeout.tv_usec;
+            p_tv = &tv;
+        }
+    } else {
+        tv.tv_sec = ctx->response_timeout.tv_sec;
+        tv.tv_usec = ctx->response_timeout.tv_usec;
+        p_tv = &tv;
+    }
+
+    for (;;) {
+        FD_ZERO(&rset);
+        FD_SET(ctx->s, &rset);
+        rc = ctx->backend->select(ctx, &rset, p_tv, 1);
+        if (rc == -1) {
+            if (errno == ETIMEDOUT && msg_length > 0) {
+                /* End of frame */
+                break;
+            }
+            _error_print(ctx, "select");
+            if (errno == ETIMEDOUT && (ctx->error_recovery & MODBUS_ERROR_RECOVERY_LINK)) {
+                _sleep_response_timeout(ctx);
+                modbus_flush(ctx);
+                errno = ETIMEDOUT;
+            }
+            return -1;
+        }
+
+        if (overflow) {
+            /* Drains the oversized frame up to the next silence */
+            rc = ctx->backend->recv(ctx, discard, sizeof(discard));
+        } else {
+            rc = ctx->backend->recv(
+                ctx, msg + msg_length, ctx->backend->max_adu_length - msg_length);
+        }
+        if (rc == 0) {
+            errno = ECONNRESET;
+            rc = -1;
+        }
+        if (rc == -1) {
+            _error_print(ctx, "read");
+            return -1;
+        }
+
+        if (ctx->debug) {
+            int i;
+            for (i = 0; i < rc && !overflow; i++)
+                printf("<%.2X>", msg[msg_length + i]);
+        }
+
+        if (!overflow) {
+            msg_length += rc;
+            if (msg_length >= (int) ctx->backend->max_adu_length) {
+                overflow = TRUE;
+            }
+        }
+
+        tv.tv_sec = silence / 1000000;
+        tv.tv_usec = silence % 1000000;
+        p_tv = &tv;
+    }
+
+    if (ctx->debug)
+        printf("\n");
+
+    if (overflow ||
+        msg_length < (int) (ctx->backend->header_length + 1 + ctx->backend->checksum_length)) {
+        errno = EMBBADDATA;
+        _error_print(ctx, overflow ? "too many data" : "frame too short");
+        return -1;
+    }
+
+    return ctx->backend->check_integrity(ctx, msg, msg_length);
+}
+
 /* Waits a response from a modbus server or a request from a modbus client.
    This function blocks if there is no replies (3 timeouts).
 
@@ -383,6 +476,13 @@ int _modbus_receive_msg(modbus_t *ctx, uint8_t *msg, msg_type_t msg_type)
         return -1;
     }
 
+    if (ctx->backend->frame_silence != NULL) {
+        int silence = ctx->backend->frame_silence(ctx);
+        if (silence > 0) {
+            return receive_msg_silence(ctx, msg, msg_type, silence);
+        }
+    }
+
     /* Add a file descriptor to the set */
     FD_ZERO(&rset);
     FD_SET(ctx->s, &rset);
@@ -555,7 +655,11 @@ int modbus_receive_confirmation(modbus_t *ctx, uint8_t *rsp)
     return _modbus_receive_msg(ctx, rsp, MSG_CONFIRMATION);
 }
 
-static int check_confirmation(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp_length)
+/* Checks the response matches the request. With recovery, the protocol error
+   recovery mode waits for the response timeout and flushes the input when the
+   check fails, without it only errno is set. */
+static int
+check_response(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp_length, int recovery)
 {
     int rc;
     int rsp_length_computed;
@@ -565,7 +669,7 @@ static int check_confirmation(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp
     if (ctx->backend->pre_check_confirmation) {
         rc = ctx->backend->pre_check_confirmation(ctx, req, rsp, rsp_length);
         if (rc == -1) {
-            if (ctx->error_recovery & MODBUS_ERROR_RECOVERY_PROTOCOL) {
+            if (recovery && (ctx->error_recovery & MODBUS_ERROR_RECOVERY_PROTOCOL)) {
                 _sleep_response_timeout(ctx);
                 modbus_flush(ctx);
             }
@@ -614,7 +718,7 @@ static int check_confirmation(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp
                     function,
                     req[offset]);
             }
-            if (ctx->error_recovery & MODBUS_ERROR_RECOVERY_PROTOCOL) {
+            if (recovery && (ctx->error_recovery & MODBUS_ERROR_RECOVERY_PROTOCOL)) {
                 _sleep_response_timeout(ctx);
                 modbus_flush(ctx);
             }
@@ -687,7 +791,7 @@ static int check_confirmation(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp
                         req_nb_value);
             }
 
-            if (ctx->error_recovery & MODBUS_ERROR_RECOVERY_PROTOCOL) {
+            if (recovery && (ctx->error_recovery & MODBUS_ERROR_RECOVERY_PROTOCOL)) {
                 _sleep_response_timeout(ctx);
                 modbus_flush(ctx);
             }
@@ -703,7 +807,7 @@ static int check_confirmation(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp
                 rsp_length,
                 rsp_length_computed);
         }
-        if (ctx->error_recovery & MODBUS_ERROR_RECOVERY_PROTOCOL) {
+        if (recovery && (ctx->error_recovery & MODBUS_ERROR_RECOVERY_PROTOCOL)) {
             _sleep_response_timeout(ctx);
             modbus_flush(ctx);
         }
@@ -714,29 +818,37 @@ static int check_confirmation(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp
     return rc;
 }
 
-static int
-response_io_status(uint8_t *tab_io_status, int address, int nb, uint8_t *rsp, int offset)
+static int check_confirmation(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp_length)
 {
-    int shift = 0;
-    /* Instead of byte (not allowed in Win32) */
-    int one_byte = 0;
-    int i;
+    return check_response(ctx, req, rsp, rsp_length, TRUE);
+}
 
-    for (i = address; i < address + nb; i++) {
-        one_byte |= tab_io_status[i] << shift;
-        if (shift == 7) {
-            /* Byte is full */
-            rsp[offset++] = one_byte;
-            one_byte = shift = 0;
-        } else {
-            shift++;
-        }
-    }
+/* Expected length of the response to req, -1 when only the response itself
+   tells (RTU monitor) */
+int _modbus_response_length(modbus_t *ctx, uint8_t *req)
+{
+    return (int) compute_response_length_from_request(ctx, req);
+}
 
-    if (shift != 0)
-        rsp[offset++] = one_byte;
+/* For the backends receiving the responses by themselves (RTU scan) */
+int _modbus_check_confirmation(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp_length)
+{
+    return check_confirmation(ctx, req, rsp, rsp_length);
+}
 
-    return offset;
+/* Same check without the recovery, for the backends reading several pending
+   responses at once (UDP batch) where a flush would drop the others */
+int _modbus_check_response(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp_length)
+{
+    return check_response(ctx, req, rsp, rsp_length, FALSE);
+}
+
+static int
+response_io_status(uint8_t *tab_io_status, int address, int nb, uint8_t *rsp, int offset)
+{
+    modbus_get_bytes_from_bits(tab_io_status, address, nb, rsp + offset);
+
+    return offset + (nb / 8) + ((nb % 8) ? 1 : 0);
 }
 
 /* Build the exception response */
@@ -1184,7 +1296,7 @@ int modbus_reply(modbus_t *ctx,
 
     /* Suppress any responses in RTU when the request was a broadcast, excepted when
      * quirk is enabled. */
-    if (ctx->backend->backend_type == _MODBUS_BACKEND_TYPE_RTU &&
+    if (ctx->backend->backend_type != _MODBUS_BACKEND_TYPE_TCP &&
         slave == MODBUS_BROADCAST_ADDRESS &&
         !(ctx->quirks & MODBUS_QUIRK_REPLY_TO_BROADCAST)) {
         return 0;
@@ -1225,8 +1337,146 @@ int modbus_reply_exception(modbus_t *ctx, const uint8_t *req, unsigned int excep
     }
 }
 
-/* Reads IO status */
-static int read_io_status(modbus_t *ctx, int function, int addr, int nb, uint8_t *dest)
+/* One slot per unit identifier, the unit id byte of the request is used as
+   index so the lookup doesn't depend on the number of hosted devices. */
+typedef struct _modbus_router_entry {
+    modbus_mapping_t *mb_mapping;
+    modbus_router_handler_t handler;
+    void *user_data;
+} modbus_router_entry_t;
+
+struct _modbus_router {
+    modbus_router_entry_t entries[256];
+};
+
+modbus_router_t *modbus_router_new(void)
+{
+    modbus_router_t *router;
+
+    router = (modbus_router_t *) malloc(sizeof(modbus_router_t));
+    if (router == NULL) {
+        return NULL;
+    }
+    memset(router, 0, sizeof(modbus_router_t));
+
+    return router;
+}
+
+void modbus_router_free(modbus_router_t *router)
+{
+    free(router);
+}
+
+int modbus_router_set_mapping(modbus_router_t *router, int unit_id, modbus_mapping_t *mb_mapping)
+{
+    if (router == NULL || unit_id < 0 || unit_id > 255 || mb_mapping == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    router->entries[unit_id].mb_mapping = mb_mapping;
+    router->entries[unit_id].handler = NULL;
+    router->entries[unit_id].user_data = NULL;
+    return 0;
+}
+
+int modbus_router_set_handler(modbus_router_t *router,
+                              int unit_id,
+                              modbus_router_handler_t handler,
+                              void *user_data)
+{
+    if (router == NULL || unit_id < 0 || unit_id > 255 || handler == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    router->entries[unit_id].mb_mapping = NULL;
+    router->entries[unit_id].handler = handler;
+    router->entries[unit_id].user_data = user_data;
+    return 0;
+}
+
+int modbus_router_remove(modbus_router_t *router, int unit_id)
+{
+    if (router == NULL || unit_id < 0 || unit_id > 255) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&router->entries[unit_id], 0, sizeof(modbus_router_entry_t));
+    return 0;
+}
+
+static int router_entry_reply(modbus_t *ctx,
+                              const uint8_t *req,
+                              int req_length,
+                              const modbus_router_entry_t *entry)
+{
+    if (entry->handler != NULL) {
+        return entry->handler(ctx, req, req_length, entry->user_data);
+    }
+
+    return modbus_reply(ctx, req, req_length, entry->mb_mapping);
+}
+
+/* Replies to the request with the mapping or handler registered for its unit
+   identifier.
+
+   In RTU, a broadcast request is applied to every registered unit (no response
+   is sent) and requests for unknown units are silently ignored. In TCP, an
+   unknown unit identifier is answered with a 'gateway path unavailable'
+   exception as a gateway would do. */
+int modbus_router_reply(modbus_t *ctx,
+                        const uint8_t *req,
+                        int req_length,
+                        modbus_router_t *router)
+{
+    const modbus_router_entry_t *entry;
+    int unit_id;
+
+    if (ctx == NULL || router == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    unit_id = req[ctx->backend->header_length - 1];
+    entry = &router->entries[unit_id];
+
+    if (ctx->backend->backend_type != _MODBUS_BACKEND_TYPE_TCP) {
+        if (unit_id == MODBUS_BROADCAST_ADDRESS && entry->mb_mapping == NULL &&
+            entry->handler == NULL) {
+            int i;
+
+            for (i = 1; i < 256; i++) {
+                entry = &router->entries[i];
+                if (entry->mb_mapping != NULL || entry->handler != NULL) {
+                    if (router_entry_reply(ctx, req, req_length, entry) == -1) {
+                        return -1;
+                    }
+                }
+            }
+            return 0;
+        }
+
+        if (entry->mb_mapping == NULL && entry->handler == NULL) {
+            if (ctx->debug) {
+                printf("No route for unit %d, request ignored\n", unit_id);
+            }
+            return 0;
+        }
+    } else if (entry->mb_mapping == NULL && entry->handler == NULL) {
+        if (ctx->debug) {
+            printf("No route for unit %d\n", unit_id);
+        }
+        return modbus_reply_exception(ctx, req, MODBUS_EXCEPTION_GATEWAY_PATH);
+    }
+
+    return router_entry_reply(ctx, req, req_length, entry);
+}
+
+/* Reads IO status, unpacked to one byte per bit or as received (packed) */
+static int
+read_io_status(modbus_t *ctx, int function, int addr, int nb, uint8_t *dest, int packed)
 {
     int rc;
     int req_length;
@@ -1238,11 +1488,7 @@ static int read_io_status(modbus_t *ctx, int function, int addr, int nb, uint8_t
 
     rc = send_msg(ctx, req, req_length);
     if (rc > 0) {
-        int temp, bit;
-        int pos = 0;
         unsigned int offset;
-        unsigned int offset_end;
-        unsigned int i;
 
         rc = _modbus_receive_msg(ctx, rsp, MSG_CONFIRMATION);
         if (rc == -1)
@@ -1253,24 +1499,21 @@ static int read_io_status(modbus_t *ctx, int function, int addr, int nb, uint8_t
             return -1;
 
         offset = ctx->backend->header_length + 2;
-        offset_end = offset + rc;
-        for (i = offset; i < offset_end; i++) {
-            /* Shift reg hi_byte to temp */
-            temp = rsp[i];
-
-            for (bit = 0x01; (bit & 0xff) && (pos < nb);) {
-                dest[pos++] = (temp & bit) ? TRUE : FALSE;
-                bit = bit << 1;
+        if (packed) {
+            memcpy(dest, rsp + offset, rc);
+            /* The padding bits of the last byte are not significant */
+            if (nb % 8) {
+                dest[rc - 1] &= (1 << (nb % 8)) - 1;
             }
+        } else {
+            modbus_set_bits_from_bytes(dest, 0, nb, rsp + offset);
         }
     }
 
     return rc;
 }
 
-/* Reads the boolean status of bits and sets the array elements
-   in the destination to TRUE or FALSE (single bits). */
-int modbus_read_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest)
+static int read_bits(modbus_t *ctx, int function, int addr, int nb, uint8_t *dest, int packed)
 {
     int rc;
 
@@ -1282,7 +1525,8 @@ int modbus_read_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest)
     if (nb > MODBUS_MAX_READ_BITS) {
         if (ctx->debug) {
             fprintf(stderr,
-                    "ERROR Too many bits requested (%d > %d)\n",
+                    "ERROR Too many %s requested (%d > %d)\n",
+                    function == MODBUS_FC_READ_COILS ? "bits" : "discrete inputs",
                     nb,
                     MODBUS_MAX_READ_BITS);
         }
@@ -1290,7 +1534,7 @@ int modbus_read_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest)
         return -1;
     }
 
-    rc = read_io_status(ctx, MODBUS_FC_READ_COILS, addr, nb, dest);
+    rc = read_io_status(ctx, function, addr, nb, dest, packed);
 
     if (rc == -1)
         return -1;
@@ -1298,33 +1542,30 @@ int modbus_read_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest)
         return nb;
 }
 
+/* Reads the boolean status of bits and sets the array elements
+   in the destination to TRUE or FALSE (single bits). */
+int modbus_read_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest)
+{
+    return read_bits(ctx, MODBUS_FC_READ_COILS, addr, nb, dest, FALSE);
+}
+
 /* Same as modbus_read_bits but reads the remote device input table */
 int modbus_read_input_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest)
 {
-    int rc;
-
-    if (ctx == NULL) {
-        errno = EINVAL;
-        return -1;
-    }
-
-    if (nb > MODBUS_MAX_READ_BITS) {
-        if (ctx->debug) {
-            fprintf(stderr,
-                    "ERROR Too many discrete inputs requested (%d > %d)\n",
-                    nb,
-                    MODBUS_MAX_READ_BITS);
-        }
-        errno = EMBMDATA;
-        return -1;
-    }
+    return read_bits(ctx, MODBUS_FC_READ_DISCRETE_INPUTS, addr, nb, dest, FALSE);
+}
 
-    rc = read_io_status(ctx, MODBUS_FC_READ_DISCRETE_INPUTS, addr, nb, dest);
+/* Same as modbus_read_bits but the destination receives the bits as packed
+   on the wire, 8 per byte starting from the lowest bit ((nb + 7) / 8 bytes) */
+int modbus_read_bits_packed(modbus_t *ctx, int addr, int nb, uint8_t *dest)
+{
+    return read_bits(ctx, MODBUS_FC_READ_COILS, addr, nb, dest, TRUE);
+}
 
-    if (rc == -1)
-        return -1;
-    else
-        return nb;
+/* Same as modbus_read_input_bits but packed as modbus_read_bits_packed */
+int modbus_read_input_bits_packed(modbus_t *ctx, int addr, int nb, uint8_t *dest)
+{
+    return read_bits(ctx, MODBUS_FC_READ_DISCRETE_INPUTS, addr, nb, dest, TRUE);
 }
 
 /* Reads the data from a remote device and put that data into an array */
@@ -1476,15 +1717,11 @@ int modbus_write_register(modbus_t *ctx, int addr, const uint16_t value)
     return write_single(ctx, MODBUS_FC_WRITE_SINGLE_REGISTER, addr, value);
 }
 
-/* Write the bits of the array in the remote device */
-int modbus_write_bits(modbus_t *ctx, int addr, int nb, const uint8_t *src)
+static int write_bits(modbus_t *ctx, int addr, int nb, const uint8_t *src, int packed)
 {
     int rc;
-    int i;
     int byte_count;
     int req_length;
-    int bit_check = 0;
-    int pos = 0;
     uint8_t req[MAX_MESSAGE_LENGTH];
 
     if (ctx == NULL) {
@@ -1508,22 +1745,15 @@ int modbus_write_bits(modbus_t *ctx, int addr, int nb, const uint8_t *src)
     byte_count = (nb / 8) + ((nb % 8) ? 1 : 0);
     req[req_length++] = byte_count;
 
-    for (i = 0; i < byte_count; i++) {
-        int bit;
-
-        bit = 0x01;
-        req[req_length] = 0;
-
-        while ((bit & 0xFF) && (bit_check++ < nb)) {
-            if (src[pos++])
-                req[req_length] |= bit;
-            else
-                req[req_length] &= ~bit;
-
-            bit = bit << 1;
+    if (packed) {
+        memcpy(req + req_length, src, byte_count);
+        if (nb % 8) {
+            req[req_length + byte_count - 1] &= (1 << (nb % 8)) - 1;
         }
-        req_length++;
+    } else {
+        modbus_get_bytes_from_bits(src, 0, nb, req + req_length);
     }
+    req_length += byte_count;
 
     rc = send_msg(ctx, req, req_length);
     if (rc > 0) {
@@ -1539,6 +1769,19 @@ int modbus_write_bits(modbus_t *ctx, int addr, int nb, const uint8_t *src)
     return rc;
 }
 
+/* Write the bits of the array in the remote device */
+int modbus_write_bits(modbus_t *ctx, int addr, int nb, const uint8_t *src)
+{
+    return write_bits(ctx, addr, nb, src, FALSE);
+}
+
+/* Same as modbus_write_bits but the bits are packed 8 per byte starting from
+   the lowest bit, as on the wire */
+int modbus_write_bits_packed(modbus_t *ctx, int addr, int nb, const uint8_t *src)
+{
+    return write_bits(ctx, addr, nb, src, TRUE);
+}
+
 /* Write the values from the array to the registers of the remote device */
 int modbus_write_registers(modbus_t *ctx, int addr, int nb, const uint16_t *src)
 {